@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <streambuf>
+#include <string_view>
+
+#include <sys/resource.h>
+
+// Общее для бенчмарков: замер времени, пиковая память и синтетический город
+namespace bench {
+
+// Минимальное из repeats время вызова run в миллисекундах: минимум меньше всего
+// зависит от фоновой нагрузки
+template <typename Run>
+double MeasureMs(Run&& run, int repeats = 5) {
+    double best = 0;
+    for (int i = 0; i < repeats; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        run();
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        best = i == 0 ? elapsed.count() : std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+// Пиковый RSS процесса с его начала, в килобайтах
+inline long GetPeakRssKb() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Поток в никуда, который только считает байты: замер вывода без записи на диск
+class NullBuffer : public std::streambuf {
+public:
+    size_t GetSize() const {
+        return size_;
+    }
+
+protected:
+    std::streamsize xsputn(const char*, std::streamsize count) override {
+        size_ += static_cast<size_t>(count);
+        return count;
+    }
+    int_type overflow(int_type ch) override {
+        ++size_;
+        return traits_type::not_eof(ch);
+    }
+
+private:
+    size_t size_ = 0;
+};
+
+inline std::string StopName(size_t index) {
+    return "Stop " + std::to_string(index);
+}
+
+// Остановки на квадратной сетке около Москвы, у каждой — расстояние до следующей.
+// Маршрут проходит bus_length подряд идущих остановок, маршруты начинаются через
+// bus_length / 2 остановок и перекрываются; каждый третий — кольцевой
+inline std::string MakeBaseRequests(size_t stop_count, size_t bus_length = 20) {
+    const auto side = static_cast<size_t>(std::max(1.0, std::sqrt(static_cast<double>(stop_count))));
+    std::string text = "[";
+    for (size_t i = 0; i < stop_count; ++i) {
+        text += R"({"type": "Stop", "name": ")" + StopName(i) + R"(", "latitude": )"
+                + std::to_string(55.5 + 0.005 * static_cast<double>(i / side))
+                + R"(, "longitude": )" + std::to_string(37.3 + 0.005 * static_cast<double>(i % side))
+                + R"(, "road_distances": {)";
+        if (i + 1 < stop_count) {
+            text += "\"" + StopName(i + 1) + "\": " + std::to_string(300 + i * 37 % 400);
+        }
+        text += "}},\n";
+    }
+    const size_t step = std::max<size_t>(1, bus_length / 2);
+    for (size_t first = 0, bus = 0; first + bus_length <= stop_count; first += step, ++bus) {
+        const bool roundtrip = bus % 3 == 0;
+        text += R"({"type": "Bus", "name": "Bus )" + std::to_string(bus) + R"(", "is_roundtrip": )"
+                + (roundtrip ? "true" : "false") + R"(, "stops": [)";
+        for (size_t stop = first; stop < first + bus_length; ++stop) {
+            text += "\"" + StopName(stop) + "\", ";
+        }
+        text += "\"" + StopName(roundtrip ? first : first + bus_length - 1) + "\"]},\n";
+    }
+    text.resize(text.size() - 2);
+    text += "]";
+    return text;
+}
+
+inline std::string_view kRoutingSettings = R"({"bus_wait_time": 6, "bus_velocity": 40})";
+
+inline std::string_view kRenderSettings = R"({"width": 1200, "height": 1200, "padding": 50,
+    "stop_radius": 5, "line_width": 14, "bus_label_font_size": 20, "bus_label_offset": [7, 15],
+    "stop_label_font_size": 20, "stop_label_offset": [7, -3], "underlayer_color": [255, 255, 255, 0.85],
+    "underlayer_width": 3, "color_palette": ["green", [255, 160, 0], "red", [0, 0, 255, 0.5]]})";
+
+// Смесь stat_requests: Bus, Stop, Route, Nearby и Suggest по кругу
+inline std::string MakeStatRequests(size_t stop_count, size_t bus_count, size_t request_count,
+                                    bool with_routes = true) {
+    std::string text = "[";
+    for (size_t id = 0; id < request_count; ++id) {
+        const size_t stop = id * 7919 % stop_count;
+        const std::string prefix = R"({"id": )" + std::to_string(id) + R"(, "type": )";
+        switch (id % (with_routes ? 5 : 4)) {
+            case 0:
+                text += prefix + R"("Bus", "name": "Bus )" + std::to_string(id % std::max<size_t>(bus_count, 1)) + "\"}";
+                break;
+            case 1:
+                text += prefix + R"("Stop", "name": ")" + StopName(stop) + "\"}";
+                break;
+            case 2:
+                text += prefix + R"("Nearby", "latitude": 55.6, "longitude": 37.4, "count": 10})";
+                break;
+            case 3:
+                text += prefix + R"("Suggest", "prefix": "Stop 1", "count": 10})";
+                break;
+            default:
+                text += prefix + R"("Route", "from": ")" + StopName(stop) + R"(", "to": ")"
+                        + StopName(id * 104729 % stop_count) + "\"}";
+                break;
+        }
+        text += id + 1 == request_count ? "" : ",\n";
+    }
+    text += "]";
+    return text;
+}
+
+inline size_t CountBuses(size_t stop_count, size_t bus_length = 20) {
+    const size_t step = std::max<size_t>(1, bus_length / 2);
+    return stop_count < bus_length ? 0 : (stop_count - bus_length) / step + 1;
+}
+
+}  // namespace bench
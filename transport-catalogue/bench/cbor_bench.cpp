@@ -0,0 +1,64 @@
+#include "benchmark.h"
+
+#include "json.h"
+#include "json_reader.h"
+#include "json_writer.h"
+#include "transport_catalogue.h"
+
+#include <ostream>
+#include <string>
+
+// Текст против CBOR на одной и той же базе: разбор в json::Document, загрузка
+// каталога через LoadBaseRequests и кодирование дерева обратно
+namespace {
+
+void BenchBase(size_t stop_count) {
+    const std::string text = R"({"base_requests": )" + bench::MakeBaseRequests(stop_count)
+                             + R"(, "render_settings": )" + std::string(bench::kRenderSettings) + "}";
+    const json::Document text_doc = json::Load(text);
+    std::string cbor;
+    json::Writer(cbor, json::Format::kCbor).Value(text_doc.GetRoot());
+    if (!(json::Load(cbor) == text_doc)) {
+        std::cout << "CBOR decodes to a different document\n";
+        return;
+    }
+    std::cout << stop_count << " stops: JSON " << text.size() / 1024 << " kB, CBOR " << cbor.size() / 1024 << " kB\n";
+
+    const double text_load_ms = bench::MeasureMs([&] {
+        json::Load(text);
+    });
+    const double cbor_load_ms = bench::MeasureMs([&] {
+        json::Load(cbor);
+    });
+    std::cout << "  json::Load: text " << text_load_ms << " ms, CBOR " << cbor_load_ms << " ms\n";
+
+    // Текст читается потоково, сразу в каталог; CBOR — через дерево
+    const double text_base_ms = bench::MeasureMs([&] {
+        catalogue::TransportCatalogue catalogue;
+        json_reader::LoadBaseRequests(text, catalogue, 1);
+    }, 3);
+    const double cbor_base_ms = bench::MeasureMs([&] {
+        catalogue::TransportCatalogue catalogue;
+        json_reader::LoadBaseRequests(cbor, catalogue, 1);
+    }, 3);
+    std::cout << "  LoadBaseRequests, one thread: text " << text_base_ms << " ms, CBOR " << cbor_base_ms << " ms\n";
+
+    bench::NullBuffer sink;
+    std::ostream null_stream(&sink);
+    const double print_ms = bench::MeasureMs([&] {
+        json::Print(text_doc, null_stream);
+    });
+    std::string output;
+    const double cbor_write_ms = bench::MeasureMs([&] {
+        output.clear();
+        json::Writer(output, json::Format::kCbor).Value(text_doc.GetRoot());
+    });
+    std::cout << "  encoding: Print " << print_ms << " ms, CBOR Writer " << cbor_write_ms << " ms\n";
+}
+
+}  // namespace
+
+int main() {
+    BenchBase(10000);
+    BenchBase(100000);
+}
@@ -0,0 +1,103 @@
+#include "benchmark.h"
+
+#include "json.h"
+#include "json_writer.h"
+
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Вывод документа в 1M узлов: json::Print в поток и json::Writer в строку,
+// текстом и в одну строку, из дерева Node и напрямую из данных
+namespace {
+
+struct Record {
+    int id = 0;
+    double lat = 0;
+    double lng = 0;
+    std::string name;
+    std::vector<double> times;
+};
+
+// Словарь и девять значений в нём: 100k записей дают миллион узлов. В именах
+// есть кавычки, обратная косая и перевод строки, чтобы экранирование работало
+std::vector<Record> MakeRecords(size_t count) {
+    std::vector<Record> records(count);
+    for (size_t i = 0; i < count; ++i) {
+        Record& record = records[i];
+        record.id = static_cast<int>(i);
+        record.lat = 55.5 + static_cast<double>(i % 1000) * 0.000731;
+        record.lng = 37.3 + static_cast<double>(i / 1000) * 0.00117;
+        record.name = "Stop \"" + std::to_string(i) + "\" \\ line\nnext";
+        record.times = {static_cast<double>(i % 60) / 7, 6, 1.0 / static_cast<double>(i + 3)};
+    }
+    return records;
+}
+
+// Ключи по возрастанию: в таком порядке словари печатает Print
+void WriteRecords(const std::vector<Record>& records, json::Writer& writer) {
+    auto array = writer.StartArray();
+    for (const Record& record : records) {
+        auto times = array.StartDict()
+                         .Key("id").Value(record.id)
+                         .Key("lat").Value(record.lat)
+                         .Key("lng").Value(record.lng)
+                         .Key("name").Value(record.name)
+                         .Key("times").StartArray();
+        for (const double time : record.times) {
+            times.Value(time);
+        }
+        times.EndArray().EndDict();
+    }
+    array.EndArray();
+}
+
+}  // namespace
+
+int main() {
+    constexpr size_t kRecords = 100000;
+    const auto records = MakeRecords(kRecords);
+    std::string text;
+    {
+        json::Writer writer(text, json::Format::kCompact);
+        WriteRecords(records, writer);
+    }
+    const json::Document doc = json::Load(text);
+    std::cout << kRecords * 10 << " nodes\n";
+
+    bench::NullBuffer sink;
+    std::ostream null_stream(&sink);
+    const double print_ms = bench::MeasureMs([&] {
+        json::Print(doc, null_stream);
+    });
+    std::cout << "Print to a stream: " << print_ms << " ms, " << sink.GetSize() / 5 / 1024 << " kB per document\n";
+
+    std::string output;
+    for (const auto format : {json::Format::kText, json::Format::kCompact}) {
+        const char* format_name = format == json::Format::kText ? "text" : "compact";
+        const double node_ms = bench::MeasureMs([&] {
+            output.clear();
+            json::Writer(output, format).Value(doc.GetRoot());
+        });
+        std::cout << "Writer from Node, " << format_name << ": " << node_ms << " ms, " << output.size() / 1024
+                  << " kB\n";
+        const double direct_ms = bench::MeasureMs([&] {
+            output.clear();
+            json::Writer writer(output, format);
+            WriteRecords(records, writer);
+        });
+        std::cout << "Writer from data, " << format_name << ": " << direct_ms << " ms, "
+                  << output.size() * 1000 / 1024 / 1024 / direct_ms << " MB/s\n";
+    }
+
+    // Writer обещает тот же вывод, что у Print
+    output.clear();
+    json::Writer(output, json::Format::kText).Value(doc.GetRoot());
+    std::ostringstream printed;
+    json::Print(doc, printed);
+    if (printed.str() != output) {
+        std::cout << "Writer output differs from Print\n";
+        return 1;
+    }
+}
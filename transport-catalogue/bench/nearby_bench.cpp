@@ -0,0 +1,86 @@
+#include "benchmark.h"
+
+#include "geo.h"
+#include "transport_catalogue.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+// Запрос Nearby по k-d дереву: постройка в Freeze, k ближайших и все в радиусе,
+// с проверкой полным перебором
+namespace {
+
+constexpr size_t kStops = 100000;
+constexpr size_t kQueries = 10000;
+
+// Случайная точка в прямоугольнике размером с город, около 30 x 30 км
+geo::Coordinates RandomPoint(std::mt19937& random) {
+    std::uniform_real_distribution<double> lat(55.55, 55.82);
+    std::uniform_real_distribution<double> lng(37.35, 37.83);
+    return {lat(random), lng(random)};
+}
+
+// Расстояния полным перебором; расходятся с деревом не больше чем на метр
+// из-за разных формул, поэтому сравниваются расстояния, а не имена
+size_t CountMismatches(const catalogue::TransportCatalogue& catalogue, geo::Coordinates center,
+                       const std::vector<catalogue::NearbyStop>& found, size_t limit, double radius) {
+    std::vector<double> distances;
+    for (const auto& stop : catalogue.GetStops()) {
+        const double distance = geo::ComputeDistance(center, stop.coordinates);
+        if (distance <= radius) {
+            distances.push_back(distance);
+        }
+    }
+    std::sort(distances.begin(), distances.end());
+    if (limit != 0 && distances.size() > limit) {
+        distances.resize(limit);
+    }
+    size_t mismatches = distances.size() > found.size() ? distances.size() - found.size() : 0;
+    for (size_t i = 0; i < std::min(distances.size(), found.size()); ++i) {
+        mismatches += std::abs(distances[i] - found[i].distance) > 1.0 ? 1 : 0;
+    }
+    return mismatches;
+}
+
+}  // namespace
+
+int main() {
+    std::mt19937 random(42);
+    catalogue::TransportCatalogue catalogue;
+    for (size_t i = 0; i < kStops; ++i) {
+        const auto point = RandomPoint(random);
+        catalogue.AddStop(bench::StopName(i), point.lat, point.lng);
+    }
+    const double freeze_ms = bench::MeasureMs([&] {
+        catalogue.Freeze();
+    }, 1);
+    std::cout << kStops << " stops, Freeze (k-d tree and name indexes) " << freeze_ms << " ms\n";
+
+    std::vector<geo::Coordinates> centers(kQueries);
+    for (auto& center : centers) {
+        center = RandomPoint(random);
+    }
+    struct Case {
+        const char* name;
+        size_t limit;
+        double radius;
+    };
+    for (const Case& query : {Case{"10 nearest", 10, INFINITY}, Case{"all within 500 m", 0, 500.0}}) {
+        size_t found = 0;
+        const double ms = bench::MeasureMs([&] {
+            for (const auto center : centers) {
+                found += catalogue.GetStopsNearby(center, query.limit, query.radius).size();
+            }
+        });
+        size_t mismatches = 0;
+        for (size_t i = 0; i < 50; ++i) {
+            const auto result = catalogue.GetStopsNearby(centers[i], query.limit, query.radius);
+            mismatches += CountMismatches(catalogue, centers[i], result, query.limit, query.radius);
+        }
+        std::cout << query.name << ": " << ms * 1000 / kQueries << " us per query, " << found / 5 / kQueries
+                  << " stops on average, " << mismatches << " mismatches with brute force\n";
+    }
+}
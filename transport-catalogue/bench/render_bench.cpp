@@ -0,0 +1,47 @@
+#include "benchmark.h"
+
+#include "json_reader.h"
+#include "map_renderer.h"
+#include "transport_catalogue.h"
+
+#include <ostream>
+#include <string>
+
+// Карта города: план отрисовки отдельно и RenderMap целиком, с выводом SVG
+namespace {
+
+void BenchCity(size_t stop_count, size_t bus_length) {
+    const std::string text = R"({"base_requests": )" + bench::MakeBaseRequests(stop_count, bus_length) + "}";
+    catalogue::TransportCatalogue catalogue;
+    json_reader::LoadBaseRequests(text, catalogue);
+    catalogue.Freeze();
+    const auto settings = renderer::GetDefaultRenderSettings();
+
+    size_t route_stops = 0;
+    for (const auto& bus : catalogue.GetBuses()) {
+        route_stops += bus.stops.size();
+    }
+    bench::NullBuffer sink;
+    std::ostream null_stream(&sink);
+    renderer::RenderMap(catalogue, settings, null_stream);
+    std::cout << stop_count << " stops, " << catalogue.GetBuses().size() << " routes, " << route_stops
+              << " route stops, map " << sink.GetSize() / 1024 << " kB\n";
+
+    size_t planned = 0;
+    const double plan_ms = bench::MeasureMs([&] {
+        planned += renderer::BuildRenderPlan(catalogue, settings).stops.size();
+    }, 30);
+    const double render_ms = bench::MeasureMs([&] {
+        renderer::RenderMap(catalogue, settings, null_stream);
+    }, 30);
+    std::cout << "  BuildRenderPlan " << plan_ms << " ms, RenderMap " << render_ms << " ms (" << planned % 10
+              << ")\n";
+}
+
+}  // namespace
+
+int main() {
+    // Около 600 маршрутов по 36 остановок и 120 маршрутов по 21 остановке
+    BenchCity(10000, 35);
+    BenchCity(1210, 20);
+}
@@ -0,0 +1,113 @@
+#include "benchmark.h"
+
+#include "json_reader.h"
+#include "transport_catalogue.h"
+
+#include <cstdint>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <malloc.h>
+
+// Индекс остановка → маршруты: память и время ответа на Stop у CSR каталога против
+// прежней схемы unordered_map<string_view, std::set<string_view>>, а также
+// дельта, в которой новые маршруты чередуются с изменением расстояний
+namespace {
+
+using SetIndex = std::unordered_map<std::string_view, std::set<std::string_view>>;
+
+size_t GetHeapInUse() {
+    return mallinfo2().uordblks;
+}
+
+void BenchIndex(const catalogue::TransportCatalogue& catalogue) {
+    const size_t heap_before = GetHeapInUse();
+    SetIndex set_index;
+    for (const auto& bus : catalogue.GetBuses()) {
+        for (std::string_view stop : bus.stops) {
+            set_index[stop].insert(bus.name);
+        }
+    }
+    const size_t set_bytes = GetHeapInUse() - heap_before;
+
+    size_t pairs = 0;
+    std::vector<std::string_view> stop_names;
+    for (const auto& stop : catalogue.GetStops()) {
+        pairs += catalogue.GetBusesForStop(stop.name).size();
+        stop_names.push_back(stop.name);
+    }
+    // Смещения на каждое имя каталога и номер маршрута на каждую пару
+    const size_t csr_bytes = (catalogue.GetNames().GetCount() + 1 + pairs) * sizeof(uint32_t);
+    std::cout << "index memory, " << pairs << " stop-bus pairs: std::set " << set_bytes / 1024
+              << " kB, CSR " << csr_bytes / 1024 << " kB\n";
+
+    // Ответ на Stop: маршруты остановки по имени, с копией имён, как в ответе
+    constexpr size_t kLookups = 1 << 21;
+    std::mt19937 random(42);
+    std::vector<std::string_view> queries(kLookups);
+    for (auto& query : queries) {
+        query = stop_names[random() % stop_names.size()];
+    }
+    size_t total = 0;
+    const double set_ms = bench::MeasureMs([&] {
+        for (const auto query : queries) {
+            std::vector<std::string> names;
+            if (const auto it = set_index.find(query); it != set_index.end()) {
+                for (const auto name : it->second) {
+                    names.emplace_back(name);
+                }
+            }
+            total += names.size();
+        }
+    });
+    const double csr_ms = bench::MeasureMs([&] {
+        for (const auto query : queries) {
+            std::vector<std::string> names;
+            for (const auto bus : catalogue.GetBusesForStop(query)) {
+                names.emplace_back(catalogue.GetNames().GetName(bus));
+            }
+            total += names.size();
+        }
+    });
+    std::cout << "Stop lookup: std::set " << set_ms * 1e6 / kLookups << " ns, CSR " << csr_ms * 1e6 / kLookups
+              << " ns (" << total % 10 << ")\n";
+}
+
+// Новый маршрут и расстояние на нём по очереди: каждое изменение расстояния
+// пересчитывает статистику маршрутов через пару остановок
+void BenchInterleavedDelta(catalogue::TransportCatalogue& catalogue, size_t stop_count) {
+    constexpr size_t kRounds = 2000;
+    catalogue::Invalidation invalidation;
+    const double ms = bench::MeasureMs([&] {
+        for (size_t round = 0; round < kRounds; ++round) {
+            const size_t first = round * 13 % (stop_count - 3);
+            const std::string from = bench::StopName(first);
+            const std::string to = bench::StopName(first + 1);
+            const std::vector<std::string_view> stops{from, to, bench::StopName(first + 2)};
+            catalogue.UpsertBus("Delta " + std::to_string(round), {stops[0], stops[1]}, false, invalidation);
+            catalogue.UpdateDistance(from, to, static_cast<int>(1000 + round), invalidation);
+        }
+    }, 1);
+    std::cout << "interleaved delta: " << kRounds << " x (UpsertBus + UpdateDistance) " << ms << " ms, "
+              << ms * 1000 / kRounds << " us per round; " << invalidation.changed_buses.size()
+              << " buses changed\n";
+    catalogue.Freeze();
+}
+
+}  // namespace
+
+int main() {
+    constexpr size_t kStops = 100000;
+    const std::string text = R"({"base_requests": )" + bench::MakeBaseRequests(kStops) + "}";
+    catalogue::TransportCatalogue catalogue;
+    json_reader::LoadBaseRequests(text, catalogue);
+    catalogue.Freeze();
+    std::cout << kStops << " stops, " << catalogue.GetBuses().size() << " buses\n";
+
+    BenchIndex(catalogue);
+    BenchInterleavedDelta(catalogue, kStops);
+}
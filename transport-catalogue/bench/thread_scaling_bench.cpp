@@ -0,0 +1,114 @@
+#include "benchmark.h"
+
+#include "json.h"
+#include "json_reader.h"
+#include "request_handler.h"
+#include "thread_pool.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <cstdint>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+// Масштабирование по числу потоков: ParallelFor на ровных и неровных задачах,
+// параллельный разбор base_requests и ответы на пакет stat_requests
+namespace {
+
+constexpr size_t kThreadCounts[] = {1, 2, 4, 8};
+
+uint64_t Spin(size_t steps, uint64_t value) {
+    for (size_t i = 0; i < steps; ++i) {
+        value = value * 6364136223846793005ull + 1442695040888963407ull;
+    }
+    return value;
+}
+
+void PrintRow(size_t threads, double ms, double single_ms) {
+    std::cout << "  threads " << threads << ": " << ms << " ms, x" << single_ms / ms << '\n';
+}
+
+void BenchParallelFor() {
+    constexpr size_t kTasks = 1 << 20;
+    std::vector<uint64_t> results(kTasks);
+    for (const bool skewed : {false, true}) {
+        // Неровные: вся дорогая работа в первой восьмой диапазона, без кражи её делал бы один поток
+        std::cout << "ParallelFor, " << kTasks << (skewed ? " skewed" : " uniform") << " tasks\n";
+        double single_ms = 0;
+        for (const size_t threads : kThreadCounts) {
+            thread_pool::ThreadPool pool(threads);
+            const double ms = bench::MeasureMs([&] {
+                pool.ParallelFor(kTasks, [&](size_t index) {
+                    const size_t steps = skewed ? (index < kTasks / 8 ? 400 : 2) : 50;
+                    results[index] = Spin(steps, index);
+                });
+            });
+            single_ms = threads == 1 ? ms : single_ms;
+            PrintRow(threads, ms, single_ms);
+        }
+    }
+}
+
+void BenchParse() {
+    constexpr size_t kStops = 100000;
+    const std::string text = R"({"base_requests": )" + bench::MakeBaseRequests(kStops) + "}";
+    std::cout << "LoadBaseRequests, " << kStops << " stops, " << text.size() / 1024 << " kB\n";
+    double single_ms = 0;
+    for (const size_t threads : kThreadCounts) {
+        const double ms = bench::MeasureMs([&] {
+            catalogue::TransportCatalogue catalogue;
+            json_reader::LoadBaseRequests(text, catalogue, threads);
+        }, 3);
+        single_ms = threads == 1 ? ms : single_ms;
+        PrintRow(threads, ms, single_ms);
+    }
+}
+
+void BenchResponses() {
+    // Матрица маршрутов считается за O(V^3), поэтому город небольшой, а запросов много
+    constexpr size_t kStops = 400;
+    constexpr size_t kRequests = 50000;
+    const std::string text = R"({"base_requests": )" + bench::MakeBaseRequests(kStops)
+                             + R"(, "routing_settings": )" + std::string(bench::kRoutingSettings)
+                             + R"(, "render_settings": )" + std::string(bench::kRenderSettings)
+                             + R"(, "stat_requests": )"
+                             + bench::MakeStatRequests(kStops, bench::CountBuses(kStops), kRequests) + "}";
+    catalogue::TransportCatalogue catalogue;
+    const auto doc = json_reader::LoadBaseRequests(text, catalogue);
+    catalogue.Freeze();
+    const auto render_settings = json_reader::ParseRenderSettings(doc);
+    const request_handler::MapCache map(catalogue, render_settings);
+    TransportRouter router(catalogue, json_reader::ParseRoutingSettings(doc));
+    router.BuildGraph();
+
+    std::cout << "ProcessRequests, " << kRequests << " requests (Bus, Stop, Nearby, Suggest, Route)\n";
+    double single_ms = 0;
+    std::string reference;
+    for (const size_t threads : kThreadCounts) {
+        json_reader::SetResponseThreads(threads);
+        std::string output;
+        const double ms = bench::MeasureMs([&] {
+            std::ostringstream out;
+            json_reader::ProcessRequests(doc, catalogue, map, router, out);
+            output = out.str();
+        }, 3);
+        if (threads == 1) {
+            single_ms = ms;
+            reference = output;
+        }
+        PrintRow(threads, ms, single_ms);
+        if (output != reference) {
+            std::cout << "  output differs from the single-thread output\n";
+        }
+    }
+}
+
+}  // namespace
+
+int main() {
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency() << '\n';
+    BenchParallelFor();
+    BenchParse();
+    BenchResponses();
+}
@@ -1 +1,38 @@
 #include "domain.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace domain {
+
+NameId NameArena::Intern(std::string_view name) {
+    if (auto it = ids_.find(name); it != ids_.end()) {
+        return it->second;
+    }
+    if (chunks_.empty() || kChunkSize - chunk_used_ < name.size()) {
+        // Имя длиннее блока получает собственный блок
+        chunks_.push_back(std::make_unique<char[]>(std::max(kChunkSize, name.size())));
+        chunk_used_ = 0;
+    }
+    char* data = chunks_.back().get() + chunk_used_;
+    chunk_used_ = std::min(kChunkSize, chunk_used_ + name.size());
+    std::memcpy(data, name.data(), name.size());
+    name_bytes_ += name.size();
+
+    const auto id = static_cast<NameId>(names_.size());
+    names_.emplace_back(data, name.size());
+    ids_.emplace(names_.back(), id);
+    return id;
+}
+
+NameId NameArena::Find(std::string_view name) const {
+    auto it = ids_.find(name);
+    return it != ids_.end() ? it->second : kNoName;
+}
+
+std::string_view NameArena::Get(std::string_view name) const {
+    const NameId id = Find(name);
+    return id != kNoName ? names_[id] : std::string_view{};
+}
+
+}  // namespace domain
@@ -1,18 +1,64 @@
 #pragma once
 #include "geo.h"
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 namespace domain {
+
+using NameId = uint32_t;
+inline constexpr NameId kNoName = UINT32_MAX;
+
+// Арена имён остановок и маршрутов. Каждое имя хранится один раз в блоках,
+// которые не перемещаются, поэтому выданные string_view действительны всё
+// время жизни арены. Номер имени — его порядковый номер в арене.
+class NameArena {
+public:
+    NameArena() = default;
+    NameArena(const NameArena&) = delete;
+    NameArena& operator=(const NameArena&) = delete;
+
+    NameId Intern(std::string_view name);
+    NameId Find(std::string_view name) const;
+    std::string_view GetName(NameId id) const {
+        return names_[id];
+    }
+    // Канонический view имени или пустой, если имя не встречалось
+    std::string_view Get(std::string_view name) const;
+
+    size_t GetCount() const {
+        return names_.size();
+    }
+    // Байты самих имён без служебных структур
+    size_t GetNameBytes() const {
+        return name_bytes_;
+    }
+
+private:
+    static constexpr size_t kChunkSize = 4096;
+
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    size_t chunk_used_ = kChunkSize;
+    size_t name_bytes_ = 0;
+    std::vector<std::string_view> names_;
+    std::unordered_map<std::string_view, NameId> ids_;
+};
+
  struct Stop {
-        std::string name;
+        std::string_view name;
         geo::Coordinates coordinates;
+        NameId id = kNoName;
     };
    
+// Имена маршрута и его остановок указывают в арену каталога
 struct Bus {
-    std::string name;
-    std::vector<std::string> stops;
+    std::string_view name;
+    std::vector<std::string_view> stops;
     bool is_roundtrip = false;
+    NameId id = kNoName;
 };
 
 }  // namespace domain
@@ -27,11 +27,16 @@ public:
     DirectedWeightedGraph() = default;
     explicit DirectedWeightedGraph(size_t vertex_count);
     EdgeId AddEdge(const Edge<Weight>& edge);
+    VertexId AddVertex();
+    // Меняет конец и вес ребра. Начало не меняется, поэтому списки инцидентности остаются верными
+    void UpdateEdge(EdgeId edge_id, VertexId to, Weight weight);
 
     size_t GetVertexCount() const;
     size_t GetEdgeCount() const;
     const Edge<Weight>& GetEdge(EdgeId edge_id) const;
     IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
+    // Все рёбра подряд, в порядке EdgeId
+    ranges::Range<const Edge<Weight>*> GetEdges() const;
 
 private:
     std::vector<Edge<Weight>> edges_;
@@ -51,6 +56,20 @@ EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
     return id;
 }
 
+template <typename Weight>
+VertexId DirectedWeightedGraph<Weight>::AddVertex() {
+    incidence_lists_.emplace_back();
+    return incidence_lists_.size() - 1;
+}
+
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::UpdateEdge(EdgeId edge_id, VertexId to, Weight weight) {
+    auto& edge = edges_.at(edge_id);
+    incidence_lists_.at(to);
+    edge.to = to;
+    edge.weight = weight;
+}
+
 template <typename Weight>
 size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
     return incidence_lists_.size();
@@ -71,4 +90,9 @@ typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
 DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
     return ranges::AsRange(incidence_lists_.at(vertex));
 }
+
+template <typename Weight>
+ranges::Range<const Edge<Weight>*> DirectedWeightedGraph<Weight>::GetEdges() const {
+    return {edges_.data(), edges_.data() + edges_.size()};
+}
 }  // namespace graph
@@ -10,7 +10,7 @@
 #include <cctype>
 
 namespace input_pars {
-using namespace geo_math;
+using geo::Coordinates;
 namespace parsers {
 
 Coordinates ParseCoordinates(std::string_view str) {
@@ -56,15 +56,12 @@ std::vector<std::string_view> Split(std::string_view s, char delim) {
     return result;
 }
 
+bool IsRoundtrip(std::string_view route) {
+    return route.find('>') != std::string_view::npos;
+}
+
 std::vector<std::string_view> ParseRoute(std::string_view route) {
-    if (route.find('>') != std::string_view::npos) {
-        return Split(route, '>');
-    }
-    auto stops = Split(route, '-');
-    std::vector<std::string_view> result(stops.begin(), stops.end());
-    if (!stops.empty())
-        result.insert(result.end(), std::next(stops.rbegin()), stops.rend());
-    return result;
+    return Split(route, IsRoundtrip(route) ? '>' : '-');
 }
 
 CommandDescription ParseCommandDescription(std::string_view line) {
@@ -119,7 +116,7 @@ void InputReader::ApplyCommands(TransportCatalogue& catalogue) const {
     for (auto& com : commands_) {
         if (com.command == "Bus") {
             auto route = ParseRoute(com.description);
-            catalogue.AddBus(com.id, route);
+            catalogue.AddBus(com.id, route, IsRoundtrip(com.description));
         }
     }
     for (auto& com : commands_) {
@@ -149,9 +146,10 @@ void InputReader::ApplyCommands(TransportCatalogue& catalogue) const {
                 auto neighbor = Trim(entry.substr(to_pos + 2));
                 if (neighbor.empty())
                     continue;
-                catalogue.AddDistance(com.id, std::string(neighbor), distance);
+                catalogue.SetDistance(com.id, std::string(neighbor), distance);
             }
         }
     }
+    catalogue.Freeze();
 }
 }
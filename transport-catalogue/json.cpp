@@ -1,9 +1,11 @@
 #include "json.h"
-#include <sstream>
-#include <iomanip>
-#include <iterator>
+#include "json_cbor.h"
+#include "json_format.h"
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstring>
 #include <stdexcept>
-#include <cctype>
 #include <string>
 #include <cmath>
 #include <limits>
@@ -13,191 +15,650 @@ namespace json {
 namespace {
     using namespace std::literals;
 
-    Node LoadNode(std::istream& input);
-    Node LoadString(std::istream& input);
+    bool IsSpace(char c) {
+        return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
 
-    std::string LoadLiteral(std::istream& input) {
-        std::string s;
-        while (std::isalpha(input.peek())) {
-            s.push_back(static_cast<char>(input.get()));
-        }
-        return s;
+    bool IsDigit(char c) {
+        return c >= '0' && c <= '9';
     }
 
-    Node LoadArray(std::istream& input) {
-        std::vector<Node> result;
-        for (char c; input >> c && c != ']';) {
-            if (c != ',') {
-                input.putback(c);
-            }
-            result.push_back(LoadNode(input));
+    bool IsAlpha(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    }
+
+    bool IsDelimiter(char c) {
+        return IsSpace(c) || c == ',' || c == ']' || c == '}';
+    }
+
+    // Строки не длиннее этого хранятся внутри std::string, без памяти в куче
+    const size_t kInlineStringCapacity = std::string().capacity();
+
+    bool CompareKeys(const Dict::value_type& lhs, const Dict::value_type& rhs) {
+        return lhs.first < rhs.first;
+    }
+
+    // Вычитывает из потока ровно одно значение, не разбирая его: следит только
+    // за вложенностью скобок и строками. Остаток потока не трогается, так что
+    // документы, идущие подряд, читаются по одному. Текст заменяет содержимое text
+    void ReadValueText(std::istream& input, std::string& text) {
+        std::streambuf& buf = *input.rdbuf();
+        constexpr auto kEof = std::char_traits<char>::eof();
+        text.clear();
+
+        int ch = buf.sgetc();
+        while (ch != kEof && IsSpace(static_cast<char>(ch))) {
+            ch = buf.snextc();
         }
-        if (!input) {
-            throw ParsingError("Array parsing error"s);
+        if (ch == kEof) {
+            input.setstate(std::ios::eofbit | std::ios::failbit);
+            throw ParsingError("Unexpected EOF"s);
+        }
+        if (ch != '[' && ch != '{' && ch != '"') {
+            // Скаляр — до первого пробела или разделителя
+            while (ch != kEof && !IsDelimiter(static_cast<char>(ch))) {
+                text.push_back(static_cast<char>(ch));
+                ch = buf.snextc();
+            }
+            return;
         }
-        return Node(std::move(result));
-    }
 
-    Node LoadDict(std::istream& input) {
-        Dict dict;
-        for (char c; input >> c && c != '}';) {
-            if (c == '"') {
-                std::string key = LoadString(input).AsString();
-                if (input >> c && c == ':') {
-                    if (dict.find(key) != dict.end()) {
-                        throw ParsingError("Duplicate key '"s + key + "' have been found");
-                    }
-                    dict.emplace(std::move(key), LoadNode(input));
-                } else {
-                    throw ParsingError(": is expected but '"s + c + "' has been found"s);
+        int depth = 0;
+        bool in_string = false;
+        bool escaped = false;
+        while (ch != kEof) {
+            const char c = static_cast<char>(ch);
+            text.push_back(c);
+            buf.sbumpc();
+            if (in_string) {
+                if (escaped) {
+                    escaped = false;
+                } else if (c == '\\') {
+                    escaped = true;
+                } else if (c == '"') {
+                    in_string = false;
                 }
-            } else if (c != ',') {
-                throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+            } else if (c == '"') {
+                in_string = true;
+            } else if (c == '[' || c == '{') {
+                ++depth;
+            } else if (c == ']' || c == '}') {
+                --depth;
             }
+            if (depth == 0 && !in_string) {
+                return;
+            }
+            ch = buf.sgetc();
         }
-        if (!input) {
-            throw ParsingError("Dictionary parsing error"s);
-        }
-        return Node(std::move(dict));
+        input.setstate(std::ios::eofbit);
     }
+} 
 
-    Node LoadString(std::istream& input) {
-        auto it = std::istreambuf_iterator<char>(input);
-        auto end = std::istreambuf_iterator<char>();
-        std::string s;
-        while (true) {
-            if (it == end) {
-                throw ParsingError("String parsing error");
+Key::Key(std::string_view text, std::pmr::memory_resource* arena) {
+    if (text.size() <= kInlineSize) {
+        std::memcpy(bytes_, text.data(), text.size());
+        bytes_[kInlineSize] = static_cast<char>(text.size());
+        return;
+    }
+    char* data = arena ? static_cast<char*>(arena->allocate(text.size(), 1)) : new char[text.size()];
+    std::memcpy(data, text.data(), text.size());
+    SetLong(data, text.size(), arena ? kInArena : kOwned);
+}
+
+Key::operator std::string_view() const {
+    if (IsLong()) {
+        const char* data;
+        uint32_t size;
+        std::memcpy(&data, bytes_, sizeof(data));
+        std::memcpy(&size, bytes_ + sizeof(data), sizeof(size));
+        return {data, size};
+    }
+    return {bytes_, GetTag()};
+}
+
+// Длинный ключ: указатель на строку, за ним её длина
+void Key::SetLong(const char* data, size_t size, unsigned char tag) {
+    const auto size32 = static_cast<uint32_t>(size);
+    std::memcpy(bytes_, &data, sizeof(data));
+    std::memcpy(bytes_ + sizeof(data), &size32, sizeof(size32));
+    bytes_[kInlineSize] = static_cast<char>(tag);
+}
+
+void Key::CopyOwned(const Key& other) {
+    const std::string_view text(other);
+    char* data = new char[text.size()];
+    std::memcpy(data, text.data(), text.size());
+    SetLong(data, text.size(), kOwned);
+}
+
+void Key::FreeOwnedData() {
+    const char* data;
+    std::memcpy(&data, bytes_, sizeof(data));
+    delete[] data;
+}
+
+namespace keys {
+
+const Key kType("type");
+const Key kName("name");
+const Key kLatitude("latitude");
+const Key kLongitude("longitude");
+const Key kRoadDistances("road_distances");
+const Key kStops("stops");
+const Key kIsRoundtrip("is_roundtrip");
+const Key kId("id");
+const Key kFrom("from");
+const Key kTo("to");
+
+}  // namespace keys
+
+Dict Dict::TakeEntries(std::vector<value_type>& entries, size_t first, std::pmr::memory_resource* resource) {
+    const auto begin = entries.begin() + first;
+    // Ключи часто уже идут по возрастанию, тогда сортировать не нужно
+    if (!std::is_sorted(begin, entries.end(), CompareKeys)) {
+        std::sort(begin, entries.end(), CompareKeys);
+    }
+    if (const auto it = std::adjacent_find(begin, entries.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.first == rhs.first;
+        });
+        it != entries.end()) {
+        const std::string key(std::string_view(it->first));
+        entries.erase(entries.begin() + first, entries.end());
+        throw ParsingError("Duplicate key '"s + key + "' have been found");
+    }
+    Storage items(std::make_move_iterator(begin), std::make_move_iterator(entries.end()), resource);
+    entries.erase(entries.begin() + first, entries.end());
+    return Dict(std::move(items));
+}
+
+Reader::Reader(std::string_view text, std::pmr::memory_resource* resource)
+    : pos_(text.data())
+    , end_(text.data() + text.size())
+    , resource_(resource) {
+}
+
+void Reader::Reset(std::string_view text) {
+    pos_ = text.data();
+    end_ = text.data() + text.size();
+    stack_.clear();
+    entries_.clear();
+    decoded_.clear();
+    first_ = false;
+}
+
+Node Reader::ReadNode() {
+    switch (NextChar()) {
+        case '[': ++pos_; return LoadArray();
+        case '{': ++pos_; return LoadDict();
+        case '"': ++pos_; return LoadString();
+        case 't': [[fallthrough]];
+        case 'f': return LoadBool();
+        case 'n': return LoadNull();
+        default: return LoadNumber();
+    }
+}
+
+void Reader::Skip() {
+    switch (NextChar()) {
+        case '[':
+            BeginArray();
+            while (NextItem()) {
+                Skip();
             }
-            const char ch = *it;
-            if (ch == '"') {
-                ++it;
+            break;
+        case '{': {
+            BeginDict();
+            std::string_view key;
+            while (NextKey(key)) {
+                Skip();
+            }
+            break;
+        }
+        case '"':
+            ReadString();
+            break;
+        default:
+            ReadNode();
+    }
+}
+
+void Reader::BeginArray() {
+    if (NextChar() != '[') {
+        throw std::logic_error("Not an array"s);
+    }
+    ++pos_;
+    first_ = true;
+}
+
+bool Reader::NextItem() {
+    return NextElement(']');
+}
+
+// Разбора здесь нет: проход следит только за строками и вложенностью скобок,
+// поэтому он в разы быстрее ReadNode. Ошибки внутри элементов найдёт разбор кусков
+std::vector<std::string_view> Reader::SplitArray(size_t max_parts) {
+    BeginArray();
+    // Длина массива заранее неизвестна; обычно он занимает почти весь остаток буфера
+    const size_t part_size = std::max<size_t>(static_cast<size_t>(end_ - pos_) / std::max<size_t>(max_parts, 1), 1);
+    std::vector<std::string_view> parts;
+    const char* part_begin = pos_;
+    auto add_part = [&parts](const char* begin, const char* end) {
+        while (begin != end && IsSpace(*begin)) {
+            ++begin;
+        }
+        while (begin != end && IsSpace(end[-1])) {
+            --end;
+        }
+        if (begin != end) {
+            parts.emplace_back(begin, static_cast<size_t>(end - begin));
+        }
+    };
+
+    size_t depth = 0;
+    for (const char* it = pos_; it != end_; ++it) {
+        switch (*it) {
+            case '"':
+                // Строка пропускается до закрывающей кавычки, экранированные символы — парами
+                for (++it;; ++it) {
+                    it = detail::FindEscape(it, end_);
+                    if (it == end_) {
+                        throw ParsingError("String parsing error"s);
+                    }
+                    if (*it == '"') {
+                        break;
+                    }
+                    if (*it == '\\' && ++it == end_) {
+                        throw ParsingError("String parsing error"s);
+                    }
+                }
                 break;
-            } else if (ch == '\\') {
-                ++it;
-                if (it == end) {
-                    throw ParsingError("String parsing error");
+            case '[': [[fallthrough]];
+            case '{':
+                ++depth;
+                break;
+            case '}':
+                if (depth == 0) {
+                    throw ParsingError("Array parsing error"s);
                 }
-                const char escaped_char = *it;
-                switch (escaped_char) {
-                    case 'n': s.push_back('\n'); break;
-                    case 't': s.push_back('\t'); break;
-                    case 'r': s.push_back('\r'); break;
-                    case '"': s.push_back('"'); break;
-                    case '\\': s.push_back('\\'); break;
-                    default:
-                        throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
+                --depth;
+                break;
+            case ']':
+                if (depth == 0) {
+                    add_part(part_begin, it);
+                    pos_ = it + 1;
+                    first_ = false;
+                    return parts;
                 }
-            } else if (ch == '\n' || ch == '\r') {
-                throw ParsingError("Unexpected end of line"s);
-            } else {
-                s.push_back(ch);
-            }
-            ++it;
+                --depth;
+                break;
+            case ',':
+                if (depth == 0 && static_cast<size_t>(it - part_begin) >= part_size) {
+                    add_part(part_begin, it);
+                    part_begin = it + 1;
+                }
+                break;
+            default:
+                break;
         }
-        return Node(std::move(s));
     }
+    throw ParsingError("Array parsing error"s);
+}
+
+void Reader::BeginPart() {
+    first_ = true;
+}
+
+bool Reader::NextPartItem() {
+    while (pos_ != end_ && IsSpace(*pos_)) {
+        ++pos_;
+    }
+    return pos_ != end_ && NextElement(']');
+}
 
-    Node LoadBool(std::istream& input) {
-        const auto s = LoadLiteral(input);
-        if (s == "true"sv) {
-            return Node{true};
-        } else if (s == "false"sv) {
-            return Node{false};
-        } else {
-            throw ParsingError("Failed to parse '"s + s + "' as bool"s);
+void Reader::BeginDict() {
+    if (NextChar() != '{') {
+        throw std::logic_error("Not a dict"s);
+    }
+    ++pos_;
+    first_ = true;
+}
+
+bool Reader::NextKey(std::string_view& key) {
+    if (!NextElement('}')) {
+        return false;
+    }
+    if (const char c = NextChar(); c != '"') {
+        throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+    }
+    key = ReadString();
+    if (const char c = NextChar(); c != ':') {
+        throw ParsingError(": is expected but '"s + c + "' has been found"s);
+    }
+    ++pos_;
+    return true;
+}
+
+// Перед первым элементом запятой нет, перед остальными она обязательна.
+// Вложенное значение всегда дочитано до конца, поэтому одного флага хватает
+bool Reader::NextElement(char close) {
+    const char c = NextChar();
+    if (c == close) {
+        ++pos_;
+        first_ = false;
+        return false;
+    }
+    if (!first_) {
+        if (c != ',') {
+            throw ParsingError(close == ']' ? "Array parsing error"s
+                                            : R"(',' is expected but ')"s + c + "' has been found"s);
         }
+        ++pos_;
     }
+    first_ = false;
+    return true;
+}
 
-    Node LoadNull(std::istream& input) {
-        if (auto literal = LoadLiteral(input); literal == "null"sv) {
-            return Node{nullptr};
-        } else {
-            throw ParsingError("Failed to parse '"s + literal + "' as null"s);
+// Строка без экранирования — это участок буфера, её не нужно копировать
+std::string_view Reader::ReadString() {
+    if (NextChar() != '"') {
+        throw std::logic_error("Not a string"s);
+    }
+    const char* begin = ++pos_;
+    for (const char* it = begin; it != end_; ++it) {
+        if (*it == '"') {
+            pos_ = it + 1;
+            return {begin, static_cast<size_t>(it - begin)};
+        }
+        if (*it == '\\' || *it == '\n' || *it == '\r') {
+            break;
         }
     }
+    decoded_.push_back(DecodeString());
+    return decoded_.back();
+}
 
-    Node LoadNumber(std::istream& input) {
-        std::string parsed_num;
-        auto read_char = [&parsed_num, &input] {
-            parsed_num += static_cast<char>(input.get());
-            if (!input) {
-                throw ParsingError("Failed to read number from stream"s);
-            }
-        };
-        auto read_digits = [&input, read_char] {
-            if (!std::isdigit(input.peek())) {
-                throw ParsingError("A digit is expected"s);
+int Reader::ReadInt() {
+    NextChar();
+    return LoadNumber().AsInt();
+}
+
+double Reader::ReadDouble() {
+    NextChar();
+    return LoadNumber().AsDouble();
+}
+
+bool Reader::ReadBool() {
+    NextChar();
+    return LoadBool().AsBool();
+}
+
+std::string_view Reader::GetRest() const {
+    return {pos_, static_cast<size_t>(end_ - pos_)};
+}
+
+// Пропускает пробелы и возвращает следующий символ, не потребляя его
+char Reader::NextChar() {
+    while (pos_ != end_ && IsSpace(*pos_)) {
+        ++pos_;
+    }
+    if (pos_ == end_) {
+        throw ParsingError("Unexpected EOF"s);
+    }
+    return *pos_;
+}
+
+std::string_view Reader::LoadLiteral() {
+    const char* begin = pos_;
+    while (pos_ != end_ && IsAlpha(*pos_)) {
+        ++pos_;
+    }
+    return {begin, static_cast<size_t>(pos_ - begin)};
+}
+
+// Элементы копятся в общем стеке и переносятся в массив одним куском точного
+// размера: вложенные массивы не перевыделяют память по мере роста
+Node Reader::LoadArray() {
+    const size_t first = stack_.size();
+    if (NextChar() == ']') {
+        ++pos_;
+        return Node(Array(resource_));
+    }
+    while (true) {
+        Node item = ReadNode();
+        stack_.push_back(std::move(item));
+        const char c = NextChar();
+        ++pos_;
+        if (c == ']') {
+            break;
+        }
+        if (c != ',') {
+            throw ParsingError("Array parsing error"s);
+        }
+    }
+    Array result(std::make_move_iterator(stack_.begin() + first), std::make_move_iterator(stack_.end()),
+                 resource_);
+    stack_.resize(first);
+    return Node(std::move(result));
+}
+
+// Пары копятся в общем стеке так же, как элементы массива, и сортируются по ключу
+// один раз, когда словарь прочитан целиком
+Node Reader::LoadDict() {
+    const size_t first = entries_.size();
+    if (NextChar() == '}') {
+        ++pos_;
+        return Node(Dict(resource_));
+    }
+    while (true) {
+        if (const char c = NextChar(); c != '"') {
+            throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+        }
+        ++pos_;
+        Key key = LoadKey();
+        if (const char c = NextChar(); c != ':') {
+            throw ParsingError(": is expected but '"s + c + "' has been found"s);
+        }
+        ++pos_;
+        Node value = ReadNode();
+        entries_.emplace_back(std::move(key), std::move(value));
+
+        const char c = NextChar();
+        ++pos_;
+        if (c == '}') {
+            break;
+        }
+        if (c != ',') {
+            throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+        }
+    }
+
+    return Node(Dict::TakeEntries(entries_, first, resource_));
+}
+
+// Строка после открывающей кавычки; участки без экранирования копируются целиком
+std::string Reader::DecodeString() {
+    std::string s;
+    const char* chunk = pos_;
+    while (true) {
+        if (pos_ == end_) {
+            throw ParsingError("String parsing error");
+        }
+        const char ch = *pos_;
+        if (ch == '"') {
+            s.append(chunk, pos_);
+            ++pos_;
+            break;
+        } else if (ch == '\\') {
+            s.append(chunk, pos_);
+            if (++pos_ == end_) {
+                throw ParsingError("String parsing error");
             }
-            while (std::isdigit(input.peek())) {
-                read_char();
+            const char escaped_char = *pos_;
+            switch (escaped_char) {
+                case 'n': s.push_back('\n'); break;
+                case 't': s.push_back('\t'); break;
+                case 'r': s.push_back('\r'); break;
+                case '"': s.push_back('"'); break;
+                case '\\': s.push_back('\\'); break;
+                default:
+                    throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
             }
-        };
-        if (input.peek() == '-') {
-            read_char();
-        }
-        if (input.peek() == '0') {
-            read_char();
+            chunk = ++pos_;
+        } else if (ch == '\n' || ch == '\r') {
+            throw ParsingError("Unexpected end of line"s);
         } else {
-            read_digits();
+            ++pos_;
         }
-        bool is_int = true;
-        if (input.peek() == '.') {
-            read_char();
-            read_digits();
-            is_int = false;
+    }
+    return s;
+}
+
+// Ключ после открывающей кавычки. Без экранирования Key строится прямо по
+// буферу, и строка не создаётся
+Key Reader::LoadKey() {
+    for (const char* it = pos_; it != end_; ++it) {
+        if (*it == '"') {
+            Key key(std::string_view(pos_, static_cast<size_t>(it - pos_)), key_arena_);
+            pos_ = it + 1;
+            return key;
         }
-        if (int ch = input.peek(); ch == 'e' || ch == 'E') {
-            read_char();
-            if (ch = input.peek(); ch == '+' || ch == '-') {
-                read_char();
-            }
-            read_digits();
-            is_int = false;
+        if (*it == '\\' || *it == '\n' || *it == '\r') {
+            break;
         }
-        try {
-            if (is_int) {
-                try {
-                    return std::stoi(parsed_num);
-                } catch (...) {
-                }
+    }
+    return Key(DecodeString(), key_arena_);
+}
+
+Node Reader::LoadString() {
+    std::string value = DecodeString();
+    heap_strings_ = heap_strings_ || value.capacity() > kInlineStringCapacity;
+    return Node(std::move(value));
+}
+
+Node Reader::LoadBool() {
+    const auto s = LoadLiteral();
+    if (s == "true"sv) {
+        return Node{true};
+    } else if (s == "false"sv) {
+        return Node{false};
+    } else {
+        throw ParsingError("Failed to parse '"s + std::string(s) + "' as bool"s);
+    }
+}
+
+Node Reader::LoadNull() {
+    if (auto literal = LoadLiteral(); literal == "null"sv) {
+        return Node{nullptr};
+    } else {
+        throw ParsingError("Failed to parse '"s + std::string(literal) + "' as null"s);
+    }
+}
+
+void Reader::ReadDigits() {
+    if (pos_ == end_ || !IsDigit(*pos_)) {
+        throw ParsingError("A digit is expected"s);
+    }
+    while (pos_ != end_ && IsDigit(*pos_)) {
+        ++pos_;
+    }
+}
+
+bool Reader::Peek(char c) const {
+    return pos_ != end_ && *pos_ == c;
+}
+
+Node Reader::LoadNumber() {
+    const char* begin = pos_;
+    if (Peek('-')) {
+        ++pos_;
+    }
+    if (Peek('0')) {
+        ++pos_;
+    } else {
+        ReadDigits();
+    }
+    bool is_int = true;
+    if (Peek('.')) {
+        ++pos_;
+        ReadDigits();
+        is_int = false;
+    }
+    if (Peek('e') || Peek('E')) {
+        ++pos_;
+        if (Peek('+') || Peek('-')) {
+            ++pos_;
+        }
+        ReadDigits();
+        is_int = false;
+    }
+    // Целое, не влезающее в int, читается как double
+    if (is_int) {
+        int value;
+        if (const auto [ptr, ec] = std::from_chars(begin, pos_, value); ec == std::errc{}) {
+            return value;
+        }
+    }
+    double value;
+    if (const auto [ptr, ec] = std::from_chars(begin, pos_, value); ec != std::errc{}) {
+        throw ParsingError("Failed to convert "s + std::string(begin, pos_) + " to number"s);
+    }
+    return value;
+}
+
+// Печать копится в буфере и уходит в поток крупными кусками: put и operator<<
+// на каждый символ стоят дороже самой печати
+class PrintBuffer {
+public:
+    explicit PrintBuffer(std::ostream& out)
+        : out_(out) {
+    }
+
+    void Write(std::string_view text) {
+        if (text.size() > kSize - size_) {
+            Flush();
+            if (text.size() > kSize) {
+                out_.write(text.data(), static_cast<std::streamsize>(text.size()));
+                return;
             }
-            return std::stod(parsed_num);
-        } catch (...) {
-            throw ParsingError("Failed to convert "s + parsed_num + " to number"s);
         }
+        std::memcpy(buffer_ + size_, text.data(), text.size());
+        size_ += text.size();
     }
 
-    Node LoadNode(std::istream& input) {
-        char c;
-        if (!(input >> c)) {
-            throw ParsingError("Unexpected EOF"s);
+    void Put(char c) {
+        if (size_ == kSize) {
+            Flush();
         }
-        switch (c) {
-            case '[': return LoadArray(input);
-            case '{': return LoadDict(input);
-            case '"': return LoadString(input);
-            case 't': [[fallthrough]];
-            case 'f':
-                input.putback(c);
-                return LoadBool(input);
-            case 'n':
-                input.putback(c);
-                return LoadNull(input);
-            default:
-                input.putback(c);
-                return LoadNumber(input);
+        buffer_[size_++] = c;
+    }
+
+    void WriteSpaces(size_t count) {
+        static constexpr std::string_view kSpaces = "                                "sv;
+        for (; count > kSpaces.size(); count -= kSpaces.size()) {
+            Write(kSpaces);
         }
+        Write(kSpaces.substr(0, count));
+    }
+
+    void Flush() {
+        out_.write(buffer_, static_cast<std::streamsize>(size_));
+        size_ = 0;
     }
-} 
+
+private:
+    static constexpr size_t kSize = 16 * 1024;
+
+    std::ostream& out_;
+    char buffer_[kSize];
+    size_t size_ = 0;
+};
 
 struct PrintContext {
-    std::ostream& out;
+    PrintBuffer& out;
     int indent_step = 4;
     int indent = 0;
     void PrintIndent() const {
-        for (int i = 0; i < indent; ++i)
-            out.put(' ');
+        out.WriteSpaces(static_cast<size_t>(indent));
     }
     PrintContext Indented() const {
         return {out, indent_step, indent + indent_step};
@@ -207,27 +668,12 @@ struct PrintContext {
 void PrintNode(const Node& value, const PrintContext& ctx);
 
 template <typename Value>
-void PrintValue(const Value& value, const PrintContext& ctx) {
-    ctx.out << value;
-}
+void PrintValue(const Value& value, const PrintContext& ctx);
 
-void PrintString(const std::string& value, std::ostream& out) {
-    out.put('"');
-    for (const char c : value) {
-        switch (c) {
-            case '\r': out << "\\r"sv; break;
-            case '\n': out << "\\n"sv; break;
-            case '\t': out << "\\t"sv; break;
-            case '"':
-            case '\\':
-                out.put('\\');
-                [[fallthrough]];
-            default:
-                out.put(c);
-                break;
-        }
-    }
-    out.put('"');
+void PrintString(std::string_view value, PrintBuffer& out) {
+    detail::WriteEscaped(value, [&out](std::string_view part) {
+        out.Write(part);
+    });
 }
 
 template <>
@@ -237,52 +683,64 @@ void PrintValue<std::string>(const std::string& value, const PrintContext& ctx)
 
 template <>
 void PrintValue<std::nullptr_t>(const std::nullptr_t&, const PrintContext& ctx) {
-    ctx.out << "null"sv;
+    ctx.out.Write("null"sv);
 }
 
 template <>
 void PrintValue<bool>(const bool& value, const PrintContext& ctx) {
-    ctx.out << (value ? "true"sv : "false"sv);
+    ctx.out.Write(value ? "true"sv : "false"sv);
+}
+
+template <>
+void PrintValue<int>(const int& value, const PrintContext& ctx) {
+    char buffer[detail::kMaxNumberLength];
+    ctx.out.Write(std::string_view(buffer, detail::FormatInt(value, buffer) - buffer));
+}
+
+template <>
+void PrintValue<double>(const double& value, const PrintContext& ctx) {
+    char buffer[detail::kMaxNumberLength];
+    ctx.out.Write(std::string_view(buffer, detail::FormatDouble(value, buffer) - buffer));
 }
 
 template <>
 void PrintValue<Array>(const Array& nodes, const PrintContext& ctx) {
-    std::ostream& out = ctx.out;
-    out << "[\n"sv;
+    PrintBuffer& out = ctx.out;
+    out.Write("[\n"sv);
     bool first = true;
     auto inner_ctx = ctx.Indented();
     for (const Node& node : nodes) {
         if (!first)
-            out << ",\n"sv;
+            out.Write(",\n"sv);
         else
             first = false;
         inner_ctx.PrintIndent();
         PrintNode(node, inner_ctx);
     }
-    out.put('\n');
+    out.Put('\n');
     ctx.PrintIndent();
-    out.put(']');
+    out.Put(']');
 }
 
 template <>
 void PrintValue<Dict>(const Dict& nodes, const PrintContext& ctx) {
-    std::ostream& out = ctx.out;
-    out << "{\n"sv;
+    PrintBuffer& out = ctx.out;
+    out.Write("{\n"sv);
     bool first = true;
     auto inner_ctx = ctx.Indented();
     for (const auto& [key, node] : nodes) {
         if (!first)
-            out << ",\n"sv;
+            out.Write(",\n"sv);
         else
             first = false;
         inner_ctx.PrintIndent();
-        PrintString(key, ctx.out);
-        out << ": "sv;
+        PrintString(key, out);
+        out.Write(": "sv);
         PrintNode(node, inner_ctx);
     }
-    out.put('\n');
+    out.Put('\n');
     ctx.PrintIndent();
-    out.put('}');
+    out.Put('}');
 }
 
 void PrintNode(const Node& node, const PrintContext& ctx) {
@@ -291,19 +749,162 @@ void PrintNode(const Node& node, const PrintContext& ctx) {
     }, node.GetValue());
 }
 
-template <>
-void PrintValue<double>(const double& value, const PrintContext& ctx) {
-    std::ostringstream oss;
-    oss << value;
-    ctx.out << oss.str();
+struct Document::Arena {
+    // Небольшой документ (например, один запрос) целиком помещается сюда
+    static constexpr size_t kInlineSize = 512;
+
+    Arena()
+        : resource(buffer, sizeof(buffer)) {
+    }
+
+    alignas(std::max_align_t) std::byte buffer[kInlineSize];
+    std::pmr::monotonic_buffer_resource resource;
+};
+
+Document::Document(Node root)
+    : Document(std::make_unique<Arena>(), std::move(root), true) {
+}
+
+Document::Document(std::unique_ptr<Arena> arena, Node root, bool needs_destruction)
+    : arena_(std::move(arena))
+    , needs_destruction_(needs_destruction) {
+    root_ = new (arena_->resource.allocate(sizeof(Node), alignof(Node))) Node(std::move(root));
+}
+
+Document::Document(Document&& other) noexcept
+    : arena_(std::move(other.arena_))
+    , root_(std::exchange(other.root_, nullptr))
+    , needs_destruction_(other.needs_destruction_) {
+}
+
+Document& Document::operator=(Document&& other) noexcept {
+    std::swap(arena_, other.arena_);
+    std::swap(root_, other.root_);
+    std::swap(needs_destruction_, other.needs_destruction_);
+    return *this;
+}
+
+Document::~Document() {
+    if (root_ && needs_destruction_) {
+        root_->~Node();
+    }
+}
+
+Document Load(std::string_view text, std::string_view* rest) {
+    auto arena = std::make_unique<Document::Arena>();
+    if (IsCbor(text)) {
+        CborReader reader(text, &arena->resource);
+        reader.key_arena_ = &arena->resource;
+        Node root = reader.ReadNode();
+        if (rest) {
+            *rest = reader.GetRest();
+        }
+        return Document(std::move(arena), std::move(root), reader.heap_strings_);
+    }
+    Reader reader(text, &arena->resource);
+    reader.key_arena_ = &arena->resource;
+    Node root = reader.ReadNode();
+    if (rest) {
+        *rest = reader.GetRest();
+    }
+    return Document(std::move(arena), std::move(root), reader.heap_strings_);
+}
+
+StreamReader::StreamReader(std::istream& input)
+    : input_(input) {
+}
+
+void StreamReader::BeginArray() {
+    if (NextChar() != '[') {
+        throw std::logic_error("Not an array"s);
+    }
+    input_.rdbuf()->sbumpc();
+    first_ = true;
+}
+
+bool StreamReader::NextItem() {
+    return NextElement(']');
+}
+
+void StreamReader::BeginDict() {
+    if (NextChar() != '{') {
+        throw std::logic_error("Not a dict"s);
+    }
+    input_.rdbuf()->sbumpc();
+    first_ = true;
+}
+
+bool StreamReader::NextKey(std::string& key) {
+    if (!NextElement('}')) {
+        return false;
+    }
+    if (const char c = NextChar(); c != '"') {
+        throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+    }
+    key = ReadNode().AsString();
+    if (const char c = NextChar(); c != ':') {
+        throw ParsingError(": is expected but '"s + c + "' has been found"s);
+    }
+    input_.rdbuf()->sbumpc();
+    return true;
+}
+
+Node StreamReader::ReadNode() {
+    ReadValueText(input_, text_);
+    reader_.Reset(text_);
+    return reader_.ReadNode();
+}
+
+bool StreamReader::HasBufferedInput() {
+    std::streambuf& buf = *input_.rdbuf();
+    while (buf.in_avail() > 0 && IsSpace(static_cast<char>(buf.sgetc()))) {
+        buf.sbumpc();
+    }
+    return buf.in_avail() > 0;
+}
+
+char StreamReader::NextChar() {
+    std::streambuf& buf = *input_.rdbuf();
+    int ch = buf.sgetc();
+    while (ch != std::char_traits<char>::eof() && IsSpace(static_cast<char>(ch))) {
+        ch = buf.snextc();
+    }
+    if (ch == std::char_traits<char>::eof()) {
+        input_.setstate(std::ios::eofbit | std::ios::failbit);
+        throw ParsingError("Unexpected EOF"s);
+    }
+    return static_cast<char>(ch);
+}
+
+// Правила те же, что у Reader::NextElement
+bool StreamReader::NextElement(char close) {
+    const char c = NextChar();
+    if (c == close) {
+        input_.rdbuf()->sbumpc();
+        first_ = false;
+        return false;
+    }
+    if (!first_) {
+        if (c != ',') {
+            throw ParsingError(close == ']' ? "Array parsing error"s
+                                            : R"(',' is expected but ')"s + c + "' has been found"s);
+        }
+        input_.rdbuf()->sbumpc();
+    }
+    first_ = false;
+    return true;
 }
 
 Document Load(std::istream& input) {
-    return Document{LoadNode(input)};
+    std::string text;
+    ReadValueText(input, text);
+    return Load(text);
 }
 
 void Print(const Document& doc, std::ostream& output) {
-    PrintNode(doc.GetRoot(), PrintContext{output});
+    PrintBuffer buffer(output);
+    PrintNode(doc.GetRoot(), PrintContext{buffer});
+    buffer.Flush();
 }
 
 }  // namespace json
@@ -1,16 +1,216 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
 #include <iostream>
-#include <map>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <variant>
 #include <vector>
 
 namespace json {
 
 class Node;
-using Dict = std::map<std::string, Node>;
-using Array = std::vector<Node>;
+class Reader;
+class CborReader;
+using Array = std::pmr::vector<Node>;
+
+// Ключ словаря, 16 байт вместо 32 у std::string. Ключ до 15 байт (это все ключи
+// схемы) хранится прямо в Key, дополненный нулями, поэтому у равных коротких
+// ключей равны байты Key, и сравнение на равенство — два сравнения 64-битных
+// чисел, без обращения к строкам. Длинный ключ — указатель на копию строки и её
+// длина. Копия лежит в арене документа, если Key построен с ней (так делает Load),
+// и тогда освобождается вместе с документом; иначе Key владеет копией в куче.
+// Короткий ключ указывает в сам Key: его string_view действителен, пока жив Key
+class Key {
+public:
+    explicit Key(std::string_view text)
+        : Key(text, nullptr) {
+    }
+    explicit Key(const char* text)
+        : Key(std::string_view(text)) {
+    }
+    explicit Key(const std::string& text)
+        : Key(std::string_view(text)) {
+    }
+    // Длинный ключ копируется в arena; nullptr — в кучу, копией владеет Key
+    Key(std::string_view text, std::pmr::memory_resource* arena);
+
+    // Копия длинного ключа всегда владеет строкой в куче: копия может пережить документ,
+    // в арене которого лежит исходный ключ. Общий указатель в арену остаётся только при перемещении
+    Key(const Key& other) {
+        if (other.IsLong()) {
+            CopyOwned(other);
+        } else {
+            std::memcpy(bytes_, other.bytes_, sizeof(bytes_));
+        }
+    }
+    Key(Key&& other) noexcept {
+        std::memcpy(bytes_, other.bytes_, sizeof(bytes_));
+        std::memset(other.bytes_, 0, sizeof(other.bytes_));
+    }
+    Key& operator=(const Key& other) {
+        if (this != &other) {
+            *this = Key(other);
+        }
+        return *this;
+    }
+    Key& operator=(Key&& other) noexcept {
+        if (this != &other) {
+            FreeOwned();
+            std::memcpy(bytes_, other.bytes_, sizeof(bytes_));
+            std::memset(other.bytes_, 0, sizeof(other.bytes_));
+        }
+        return *this;
+    }
+    ~Key() {
+        FreeOwned();
+    }
+
+    operator std::string_view() const;
+
+    friend bool operator==(const Key& lhs, const Key& rhs) {
+        // Сравнение 16 байт фиксированной длины компилятор делает двумя сравнениями слов.
+        // Равные длинные ключи могут лежать в разных копиях — тогда сравниваются строки
+        return std::memcmp(lhs.bytes_, rhs.bytes_, sizeof(bytes_)) == 0
+            || (lhs.IsLong() && rhs.IsLong() && std::string_view(lhs) == std::string_view(rhs));
+    }
+    friend bool operator!=(const Key& lhs, const Key& rhs) {
+        return !(lhs == rhs);
+    }
+    friend bool operator<(const Key& lhs, const Key& rhs) {
+        return std::string_view(lhs) < std::string_view(rhs);
+    }
+
+private:
+    static constexpr size_t kInlineSize = 15;
+    // Последний байт: длина короткого ключа, kInArena или kOwned
+    static constexpr unsigned char kInArena = 0xFE;
+    static constexpr unsigned char kOwned = 0xFF;
+
+    unsigned char GetTag() const {
+        return static_cast<unsigned char>(bytes_[kInlineSize]);
+    }
+    bool IsLong() const {
+        return GetTag() > kInlineSize;
+    }
+    void SetLong(const char* data, size_t size, unsigned char tag);
+    void CopyOwned(const Key& other);
+    void FreeOwned() {
+        if (GetTag() == kOwned) {
+            FreeOwnedData();
+        }
+    }
+    void FreeOwnedData();
+
+    alignas(uint64_t) char bytes_[kInlineSize + 1] = {};
+};
+
+// Ключи схемы, которые есть почти в каждом запросе. Все они короткие, поэтому
+// поиск по ним в небольшом словаре сравнивает только байты Key
+namespace keys {
+
+extern const Key kType;
+extern const Key kName;
+extern const Key kLatitude;
+extern const Key kLongitude;
+extern const Key kRoadDistances;
+extern const Key kStops;
+extern const Key kIsRoundtrip;
+extern const Key kId;
+extern const Key kFrom;
+extern const Key kTo;
+
+}  // namespace keys
+
+// Словарь — вектор пар, упорядоченный по ключу: элементы лежат подряд, без узла
+// дерева и отдельного выделения памяти на каждый ключ. Интерфейс повторяет нужную
+// часть std::map, обход идёт по возрастанию ключей. Вставка сдвигает хвост, так
+// что большие словари лучше собирать разбором (Reader сортирует ключи один раз)
+class Dict {
+public:
+    using key_type = Key;
+    using mapped_type = Node;
+    using value_type = std::pair<Key, Node>;
+    using Storage = std::pmr::vector<value_type>;
+    using iterator = Storage::iterator;
+    using const_iterator = Storage::const_iterator;
+
+    Dict() = default;
+    explicit Dict(std::pmr::memory_resource* resource)
+        : items_(resource) {
+    }
+    // Как у std::map: из повторяющихся ключей остаётся первый
+    Dict(std::initializer_list<std::pair<std::string_view, Node>> items);
+
+    iterator begin() {
+        return items_.begin();
+    }
+    iterator end() {
+        return items_.end();
+    }
+    const_iterator begin() const {
+        return items_.begin();
+    }
+    const_iterator end() const {
+        return items_.end();
+    }
+    size_t size() const {
+        return items_.size();
+    }
+    bool empty() const {
+        return items_.empty();
+    }
+
+    // Ключ может быть строкой или Key; с Key поиск не сравнивает строки
+    template <typename K>
+    iterator find(const K& key);
+    template <typename K>
+    const_iterator find(const K& key) const;
+    template <typename K>
+    size_t count(const K& key) const;
+    template <typename K>
+    Node& at(const K& key);
+    template <typename K>
+    const Node& at(const K& key) const;
+
+    template <typename K, typename... Args>
+    std::pair<iterator, bool> emplace(K&& key, Args&&... args);
+
+    friend bool operator==(const Dict& lhs, const Dict& rhs);
+
+private:
+    friend class Reader;
+    friend class CborReader;
+
+    // Из пар, уже упорядоченных по ключу и без повторов
+    explicit Dict(Storage items)
+        : items_(std::move(items)) {
+    }
+
+    // Словарь из хвоста entries, начиная с first, в порядке разбора. Пары
+    // сортируются один раз, повтор ключа — ParsingError; хвост убирается из entries
+    static Dict TakeEntries(std::vector<value_type>& entries, size_t first,
+                            std::pmr::memory_resource* resource);
+
+    // Словари до такого размера ищут Key перебором: сравнение указателей дешевле
+    // двоичного поиска по строкам
+    static constexpr size_t kLinearSearchSize = 16;
+
+    iterator LowerBound(std::string_view key);
+    iterator FindKey(const Key& key);
+    iterator FindText(std::string_view key);
+
+    Storage items_;
+};
 
 class ParsingError : public std::runtime_error {
 public:
@@ -117,18 +317,111 @@ inline bool operator!=(const Node& lhs, const Node& rhs) {
     return !(lhs == rhs);
 }
 
+inline Dict::iterator Dict::LowerBound(std::string_view key) {
+    return std::lower_bound(items_.begin(), items_.end(), key, [](const value_type& item, std::string_view key) {
+        return std::string_view(item.first) < key;
+    });
+}
+
+inline Dict::iterator Dict::FindText(std::string_view key) {
+    const auto it = LowerBound(key);
+    return it != items_.end() && std::string_view(it->first) == key ? it : items_.end();
+}
+
+inline Dict::iterator Dict::FindKey(const Key& key) {
+    if (items_.size() > kLinearSearchSize) {
+        return FindText(key);
+    }
+    for (auto it = items_.begin(); it != items_.end(); ++it) {
+        if (it->first == key) {
+            return it;
+        }
+    }
+    return items_.end();
+}
+
+template <typename K>
+Dict::iterator Dict::find(const K& key) {
+    if constexpr (std::is_same_v<K, Key>) {
+        return FindKey(key);
+    } else {
+        return FindText(key);
+    }
+}
+
+template <typename K>
+Dict::const_iterator Dict::find(const K& key) const {
+    return const_cast<Dict*>(this)->find(key);
+}
+
+template <typename K>
+size_t Dict::count(const K& key) const {
+    return find(key) != end() ? 1 : 0;
+}
+
+template <typename K>
+Node& Dict::at(const K& key) {
+    const auto it = find(key);
+    if (it == items_.end()) {
+        // Текст тот же, что у std::map::at: его видят клиенты в сообщениях об ошибке
+        throw std::out_of_range("map::at");
+    }
+    return it->second;
+}
+
+template <typename K>
+const Node& Dict::at(const K& key) const {
+    return const_cast<Dict*>(this)->at(key);
+}
+
+template <typename K, typename... Args>
+std::pair<Dict::iterator, bool> Dict::emplace(K&& key, Args&&... args) {
+    const std::string_view text(key);
+    auto it = LowerBound(text);
+    if (it != items_.end() && std::string_view(it->first) == text) {
+        return {it, false};
+    }
+    it = items_.emplace(it, std::piecewise_construct, std::forward_as_tuple(Key(text)),
+                        std::forward_as_tuple(std::forward<Args>(args)...));
+    return {it, true};
+}
+
+inline Dict::Dict(std::initializer_list<std::pair<std::string_view, Node>> items) {
+    items_.reserve(items.size());
+    for (const auto& [key, value] : items) {
+        emplace(key, value);
+    }
+}
+
+inline bool operator==(const Dict& lhs, const Dict& rhs) {
+    return lhs.items_ == rhs.items_;
+}
+
+// Документ держит дерево в своей арене: контейнеры узлов выделяются подряд из
+// крупных блоков и освобождаются вместе с ней. Если узлы не владеют памятью вне
+// арены (в дереве нет длинных строк), деструкторы узлов не вызываются вовсе и
+// документ освобождается, не обходя дерево
 class Document {
 public:
-    explicit Document(Node root)
-        : root_(std::move(root)) {
-    }
+    explicit Document(Node root);
+    Document(Document&& other) noexcept;
+    Document& operator=(Document&& other) noexcept;
+    ~Document();
 
     const Node& GetRoot() const {
-        return root_;
+        return *root_;
     }
 
 private:
-    Node root_;
+    struct Arena;
+
+    friend Document Load(std::string_view text, std::string_view* rest);
+
+    Document(std::unique_ptr<Arena> arena, Node root, bool needs_destruction);
+
+    std::unique_ptr<Arena> arena_;
+    Node* root_ = nullptr;
+    bool needs_destruction_ = true;
 };
 
 inline bool operator==(const Document& lhs, const Document& rhs) {
@@ -139,7 +432,111 @@ inline bool operator!=(const Document& lhs, const Document& rhs) {
     return !(lhs == rhs);
 }
 
+// Потоковое чтение из непрерывного буфера без построения дерева: вызывающий
+// сам обходит структуру и пропускает ненужное. Строки без экранирования
+// указывают прямо в буфер, остальные хранит Reader, так что все они живут,
+// пока живы буфер и Reader
+class Reader {
+public:
+    // Контейнеры узлов, которые строит ReadNode, выделяются из resource
+    explicit Reader(std::string_view text,
+                    std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // Значение целиком, как его разбирает Load
+    Node ReadNode();
+    // Пропускает значение, ничего не сохраняя
+    void Skip();
+
+    // Массив: BeginArray, затем NextItem перед каждым элементом, пока не вернёт false
+    void BeginArray();
+    bool NextItem();
+    // Делит массив на куски не больше чем max_parts примерно равной длины по
+    // границам элементов и переходит за массив. Кусок — текст элементов через
+    // запятую, без скобок; куски можно разбирать параллельно, каждый своим Reader
+    std::vector<std::string_view> SplitArray(size_t max_parts);
+    // Кусок из SplitArray: BeginPart, затем NextPartItem перед каждым элементом
+    void BeginPart();
+    bool NextPartItem();
+    // Словарь: BeginDict, затем NextKey перед каждым значением, пока не вернёт false
+    void BeginDict();
+    bool NextKey(std::string_view& key);
+
+    std::string_view ReadString();
+    int ReadInt();
+    double ReadDouble();
+    bool ReadBool();
+
+    // Непрочитанный остаток буфера
+    std::string_view GetRest() const;
+    // Продолжает с другого буфера; память под стеки разбора остаётся за Reader.
+    // Строки, прочитанные из прежнего буфера, перестают быть действительными
+    void Reset(std::string_view text);
+
+private:
+    char NextChar();
+    bool NextElement(char close);
+    std::string_view LoadLiteral();
+    Node LoadArray();
+    Node LoadDict();
+    std::string DecodeString();
+    Key LoadKey();
+    Node LoadString();
+    Node LoadBool();
+    Node LoadNull();
+    void ReadDigits();
+    bool Peek(char c) const;
+    Node LoadNumber();
+
+    friend Document Load(std::string_view text, std::string_view* rest);
+
+    const char* pos_;
+    const char* end_;
+    std::pmr::memory_resource* resource_;
+    // Элементы незаконченных массивов и словарей; готовый контейнер забирает свой хвост
+    std::vector<Node> stack_;
+    std::vector<Dict::value_type> entries_;
+    std::deque<std::string> decoded_;
+    bool first_ = false;
+    // Какая-то из прочитанных строк не поместилась во встроенный буфер std::string
+    bool heap_strings_ = false;
+    // Арена документа для длинных ключей; её ставит Load, иначе ключи владеют копией
+    std::pmr::memory_resource* key_arena_ = nullptr;
+};
+
+// Потоковое чтение из std::istream: внешние уровни документа обходятся так же,
+// как в Reader, а значения внутри них вычитываются и разбираются по одному.
+// Памяти нужно на одно такое значение, а не на весь документ
+class StreamReader {
+public:
+    explicit StreamReader(std::istream& input);
+
+    void BeginArray();
+    bool NextItem();
+    void BeginDict();
+    bool NextKey(std::string& key);
+    Node ReadNode();
+
+    // Есть ли во входном буфере что-то кроме пробелов (пробелы пропускаются).
+    // Если нет, следующее чтение может ждать ввода
+    bool HasBufferedInput();
+
+private:
+    char NextChar();
+    bool NextElement(char close);
+
+    std::istream& input_;
+    bool first_ = false;
+    // Текст очередного значения и его разбор переиспользуются от значения к значению
+    std::string text_;
+    Reader reader_{{}};
+};
+
+// Читает из потока один текстовый документ; следующие за ним данные остаются в потоке
 Document Load(std::istream& input);
+// Разбирает документ из начала буфера; если rest задан, в него попадает
+// непрочитанный остаток (например, следующие документы). Буфер в CBOR
+// распознаётся по первому байту (см. IsCbor) и разбирается CborReader
+Document Load(std::string_view text, std::string_view* rest = nullptr);
 
 void Print(const Document& doc, std::ostream& output);
 
@@ -0,0 +1,320 @@
+#include "json_cbor.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace json {
+
+namespace {
+
+using namespace std::literals;
+
+// Старшие три бита начального байта
+constexpr uint8_t kUnsigned = 0;
+constexpr uint8_t kNegative = 1;
+constexpr uint8_t kBytes = 2;
+constexpr uint8_t kText = 3;
+constexpr uint8_t kArray = 4;
+constexpr uint8_t kMap = 5;
+constexpr uint8_t kTag = 6;
+constexpr uint8_t kSimple = 7;
+
+// Младшие пять бит: длина аргумента
+constexpr uint8_t kOneByte = 24;
+constexpr uint8_t kIndefinite = 31;
+
+// Простые значения и числа с плавающей точкой (старший тип kSimple)
+constexpr uint8_t kFalse = 20;
+constexpr uint8_t kTrue = 21;
+constexpr uint8_t kNull = 22;
+constexpr uint8_t kHalf = 25;
+constexpr uint8_t kFloat = 26;
+constexpr uint8_t kDouble = 27;
+
+// Метка самоописания 55799: необязательный признак CBOR в начале данных
+constexpr std::string_view kSelfDescribe = "\xD9\xD9\xF7"sv;
+
+// Глубже документы не бывают; ограничение защищает стек от испорченного входа
+constexpr size_t kMaxDepth = 256;
+
+const size_t kInlineStringCapacity = std::string().capacity();
+
+constexpr uint64_t kMaxInt = static_cast<uint64_t>(std::numeric_limits<int>::max());
+
+double DecodeHalf(uint16_t bits) {
+    const int exponent = (bits >> 10) & 0x1F;
+    const int mantissa = bits & 0x3FF;
+    double value;
+    if (exponent == 0) {
+        value = std::ldexp(mantissa, -24);
+    } else if (exponent != 31) {
+        value = std::ldexp(mantissa + 1024, exponent - 25);
+    } else {
+        value = mantissa == 0 ? std::numeric_limits<double>::infinity() : std::numeric_limits<double>::quiet_NaN();
+    }
+    return (bits & 0x8000) ? -value : value;
+}
+
+}  // namespace
+
+bool IsCbor(std::string_view data) {
+    if (data.empty()) {
+        return false;
+    }
+    const auto first = static_cast<unsigned char>(data.front());
+    return (first >> 5) == kArray || (first >> 5) == kMap || data.substr(0, kSelfDescribe.size()) == kSelfDescribe;
+}
+
+CborReader::CborReader(std::string_view data, std::pmr::memory_resource* resource)
+    : pos_(reinterpret_cast<const unsigned char*>(data.data()))
+    , end_(pos_ + data.size())
+    , resource_(resource) {
+}
+
+std::string_view CborReader::GetRest() const {
+    return {reinterpret_cast<const char*>(pos_), static_cast<size_t>(end_ - pos_)};
+}
+
+Node CborReader::ReadNode() {
+    Header header = ReadHeader();
+    while (header.major == kTag) {
+        header = ReadHeader();
+    }
+    switch (header.major) {
+        case kUnsigned: [[fallthrough]];
+        case kNegative:
+            return LoadInteger(header);
+        case kBytes:
+            throw ParsingError("CBOR byte strings are not supported"s);
+        case kText: {
+            std::string value = LoadText(header);
+            heap_strings_ = heap_strings_ || value.capacity() > kInlineStringCapacity;
+            return Node(std::move(value));
+        }
+        case kArray:
+            return LoadArray(header);
+        case kMap:
+            return LoadDict(header);
+        default:
+            return LoadSimple(header);
+    }
+}
+
+CborReader::Header CborReader::ReadHeader() {
+    const uint8_t initial = ReadByte();
+    Header header{static_cast<uint8_t>(initial >> 5), static_cast<uint8_t>(initial & 0x1F), 0, false};
+    if (header.info < kOneByte) {
+        header.argument = header.info;
+    } else if (header.info <= kDouble) {
+        header.argument = ReadBigEndian(size_t{1} << (header.info - kOneByte));
+    } else if (header.info == kIndefinite
+               && (header.major == kBytes || header.major == kText || header.major == kArray
+                   || header.major == kMap || header.major == kSimple)) {
+        header.indefinite = true;
+    } else {
+        throw ParsingError("Invalid CBOR header "s + std::to_string(initial));
+    }
+    return header;
+}
+
+uint8_t CborReader::ReadByte() {
+    if (pos_ == end_) {
+        throw ParsingError("Unexpected end of CBOR data"s);
+    }
+    return *pos_++;
+}
+
+uint64_t CborReader::ReadBigEndian(size_t size) {
+    if (static_cast<size_t>(end_ - pos_) < size) {
+        throw ParsingError("Unexpected end of CBOR data"s);
+    }
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; ++i) {
+        value = (value << 8) | pos_[i];
+    }
+    pos_ += size;
+    return value;
+}
+
+std::string_view CborReader::ReadBytes(uint64_t size) {
+    if (static_cast<uint64_t>(end_ - pos_) < size) {
+        throw ParsingError("Unexpected end of CBOR data"s);
+    }
+    const std::string_view bytes(reinterpret_cast<const char*>(pos_), static_cast<size_t>(size));
+    pos_ += size;
+    return bytes;
+}
+
+size_t CborReader::CheckCount(uint64_t count, size_t min_item_size) const {
+    if (count > static_cast<uint64_t>(end_ - pos_) / min_item_size) {
+        throw ParsingError("Unexpected end of CBOR data"s);
+    }
+    return static_cast<size_t>(count);
+}
+
+bool CborReader::AtBreak() {
+    if (pos_ == end_) {
+        throw ParsingError("Unexpected end of CBOR data"s);
+    }
+    if (*pos_ == static_cast<unsigned char>(detail::kCborBreak)) {
+        ++pos_;
+        return true;
+    }
+    return false;
+}
+
+// Целое, не влезающее в int, читается как double — так же, как в тексте
+Node CborReader::LoadInteger(const Header& header) {
+    if (header.argument <= kMaxInt) {
+        const int value = static_cast<int>(header.argument);
+        return header.major == kUnsigned ? Node(value) : Node(-1 - value);
+    }
+    const double value = static_cast<double>(header.argument);
+    return header.major == kUnsigned ? Node(value) : Node(-1.0 - value);
+}
+
+Node CborReader::LoadSimple(const Header& header) {
+    if (header.indefinite) {
+        throw ParsingError("Unexpected CBOR break"s);
+    }
+    switch (header.info) {
+        case kFalse: return Node(false);
+        case kTrue: return Node(true);
+        case kNull: return Node(nullptr);
+        case kHalf: return Node(DecodeHalf(static_cast<uint16_t>(header.argument)));
+        case kFloat: {
+            const auto bits = static_cast<uint32_t>(header.argument);
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return Node(static_cast<double>(value));
+        }
+        case kDouble: {
+            double value;
+            std::memcpy(&value, &header.argument, sizeof(value));
+            return Node(value);
+        }
+        default:
+            throw ParsingError("Unsupported CBOR simple value "s + std::to_string(header.argument));
+    }
+}
+
+// Строка неопределённой длины — последовательность кусков определённой длины
+std::string CborReader::LoadText(const Header& header) {
+    if (!header.indefinite) {
+        return std::string(ReadBytes(header.argument));
+    }
+    std::string value;
+    while (!AtBreak()) {
+        const Header chunk = ReadHeader();
+        if (chunk.major != kText || chunk.indefinite) {
+            throw ParsingError("Invalid chunk of a CBOR text string"s);
+        }
+        value += ReadBytes(chunk.argument);
+    }
+    return value;
+}
+
+// Ключ определённой длины строится прямо по буферу, без промежуточной строки
+Key CborReader::LoadKey() {
+    Header header = ReadHeader();
+    while (header.major == kTag) {
+        header = ReadHeader();
+    }
+    if (header.major != kText) {
+        throw ParsingError("CBOR map keys must be text strings"s);
+    }
+    if (!header.indefinite) {
+        return Key(ReadBytes(header.argument), key_arena_);
+    }
+    return Key(LoadText(header), key_arena_);
+}
+
+// Элементы копятся в общем стеке, как у Reader: у массива неопределённой длины
+// размер заранее неизвестен, а рост вектора в арене оставлял бы в ней брошенные буферы
+Node CborReader::LoadArray(const Header& header) {
+    if (++depth_ > kMaxDepth) {
+        throw ParsingError("CBOR nesting is too deep"s);
+    }
+    const size_t first = stack_.size();
+    if (header.indefinite) {
+        while (!AtBreak()) {
+            stack_.push_back(ReadNode());
+        }
+    } else {
+        for (size_t count = CheckCount(header.argument, 1); count > 0; --count) {
+            stack_.push_back(ReadNode());
+        }
+    }
+    Array result(std::make_move_iterator(stack_.begin() + first), std::make_move_iterator(stack_.end()),
+                 resource_);
+    stack_.resize(first);
+    --depth_;
+    return Node(std::move(result));
+}
+
+Node CborReader::LoadDict(const Header& header) {
+    if (++depth_ > kMaxDepth) {
+        throw ParsingError("CBOR nesting is too deep"s);
+    }
+    const size_t first = entries_.size();
+    // Пара занимает хотя бы два байта: пустой ключ и простое значение
+    for (size_t count = header.indefinite ? 0 : CheckCount(header.argument, 2);
+         header.indefinite ? !AtBreak() : count > 0; --count) {
+        Key key = LoadKey();
+        Node value = ReadNode();
+        entries_.emplace_back(std::move(key), std::move(value));
+    }
+    --depth_;
+    return Node(Dict::TakeEntries(entries_, first, resource_));
+}
+
+namespace detail {
+
+void WriteCborHeader(uint8_t major, uint64_t argument, std::string& output) {
+    const auto initial = static_cast<char>(major << 5);
+    if (argument < kOneByte) {
+        output += static_cast<char>(initial | static_cast<char>(argument));
+        return;
+    }
+    // Аргумент длиной 1, 2, 4 или 8 байт отмечается числом 24, 25, 26 или 27
+    int size_code = 3;
+    if (argument <= 0xFF) {
+        size_code = 0;
+    } else if (argument <= 0xFFFF) {
+        size_code = 1;
+    } else if (argument <= 0xFFFFFFFF) {
+        size_code = 2;
+    }
+    const size_t size = size_t{1} << size_code;
+    output += static_cast<char>(initial | static_cast<char>(kOneByte + size_code));
+    for (size_t i = size; i-- > 0;) {
+        output += static_cast<char>((argument >> (8 * i)) & 0xFF);
+    }
+}
+
+void WriteCborInt(int64_t value, std::string& output) {
+    if (value >= 0) {
+        WriteCborHeader(kUnsigned, static_cast<uint64_t>(value), output);
+    } else {
+        WriteCborHeader(kNegative, static_cast<uint64_t>(-1 - value), output);
+    }
+}
+
+void WriteCborDouble(double value, std::string& output) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    output += static_cast<char>((kSimple << 5) | kDouble);
+    for (size_t i = 8; i-- > 0;) {
+        output += static_cast<char>((bits >> (8 * i)) & 0xFF);
+    }
+}
+
+void WriteCborText(std::string_view value, std::string& output) {
+    WriteCborHeader(kText, value.size(), output);
+    output += value;
+}
+
+}  // namespace detail
+
+}  // namespace json
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "json.h"
+
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace json {
+
+// Двоичный вход и выход в CBOR (RFC 8949) вместо текста JSON. Модель данных та же:
+// словари с текстовыми ключами, массивы, строки, числа, true/false/null.
+// Документ CBOR начинается с заголовка словаря или массива (байты 0x80-0xBF) или
+// с метки самоописания 0xD9D9F7, а текст JSON — с пробела или ASCII-символа,
+// поэтому формат определяется по первому байту, без отдельного флага
+bool IsCbor(std::string_view data);
+
+// Разбор CBOR в те же узлы, что строит Reader. Поддерживаются целые (не
+// влезающие в int становятся double), float16/32/64, текстовые строки (и
+// составные), массивы и словари определённой и неопределённой длины. Метки
+// пропускаются; байтовые строки, undefined и прочие простые значения — ошибка
+class CborReader {
+public:
+    explicit CborReader(std::string_view data,
+                        std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    Node ReadNode();
+    // Непрочитанный остаток буфера
+    std::string_view GetRest() const;
+
+private:
+    struct Header {
+        uint8_t major;
+        uint8_t info;
+        uint64_t argument;
+        bool indefinite;
+    };
+
+    Header ReadHeader();
+    uint8_t ReadByte();
+    uint64_t ReadBigEndian(size_t size);
+    std::string_view ReadBytes(uint64_t size);
+    // Для определённой длины: не больше элементов, чем байт осталось в буфере
+    size_t CheckCount(uint64_t count, size_t min_item_size) const;
+    bool AtBreak();
+
+    Node LoadInteger(const Header& header);
+    Node LoadSimple(const Header& header);
+    std::string LoadText(const Header& header);
+    Key LoadKey();
+    Node LoadArray(const Header& header);
+    Node LoadDict(const Header& header);
+
+    friend Document Load(std::string_view text, std::string_view* rest);
+
+    const unsigned char* pos_;
+    const unsigned char* end_;
+    std::pmr::memory_resource* resource_;
+    // Элементы незаконченных массивов и словарей, как у Reader
+    std::vector<Node> stack_;
+    std::vector<Dict::value_type> entries_;
+    size_t depth_ = 0;
+    // Как у Reader: какая-то строка не поместилась во встроенный буфер std::string
+    bool heap_strings_ = false;
+    // Как у Reader: арена документа для длинных ключей
+    std::pmr::memory_resource* key_arena_ = nullptr;
+};
+
+namespace detail {
+
+// Примитивы кодирования для Writer: заголовок, числа и строки CBOR
+void WriteCborHeader(uint8_t major, uint64_t argument, std::string& output);
+void WriteCborInt(int64_t value, std::string& output);
+void WriteCborDouble(double value, std::string& output);
+void WriteCborText(std::string_view value, std::string& output);
+
+// Начальные байты неопределённых массива и словаря, конец неопределённой длины
+// и простые значения
+constexpr char kCborArrayStart = '\x9F';
+constexpr char kCborDictStart = '\xBF';
+constexpr char kCborBreak = '\xFF';
+constexpr char kCborFalse = '\xF4';
+constexpr char kCborTrue = '\xF5';
+constexpr char kCborNull = '\xF6';
+
+}  // namespace detail
+
+}  // namespace json
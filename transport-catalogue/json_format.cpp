@@ -0,0 +1,68 @@
+#include "json_format.h"
+
+#include <charconv>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace json::detail {
+
+using namespace std::literals;
+
+namespace {
+
+bool NeedsEscape(char c) {
+    return c == '"' || c == '\\' || c == '\r' || c == '\n' || c == '\t';
+}
+
+}  // namespace
+
+char* FormatInt(int value, char* buffer) {
+    return std::to_chars(buffer, buffer + kMaxNumberLength, value).ptr;
+}
+
+char* FormatDouble(double value, char* buffer) {
+    // to_chars с точностью даёт ровно то же, что printf "%.*g", но без разбора
+    // формата и без локали
+    return std::to_chars(buffer, buffer + kMaxNumberLength, value, std::chars_format::general, 6).ptr;
+}
+
+const char* FindEscape(const char* begin, const char* end) {
+#if defined(__SSE2__)
+    // По 16 байт: сравнение со всеми пятью символами сразу, в подавляющем большинстве
+    // строк блок целиком обычный
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i tab = _mm_set1_epi8('\t');
+    for (; end - begin >= 16; begin += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        const __m128i found = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, cr), _mm_cmpeq_epi8(chunk, lf)),
+                         _mm_cmpeq_epi8(chunk, tab)));
+        if (const int mask = _mm_movemask_epi8(found); mask != 0) {
+            return begin + __builtin_ctz(static_cast<unsigned>(mask));
+        }
+    }
+#endif
+    while (begin != end && !NeedsEscape(*begin)) {
+        ++begin;
+    }
+    return begin;
+}
+
+std::string_view GetEscape(char c) {
+    switch (c) {
+        case '\r': return "\\r"sv;
+        case '\n': return "\\n"sv;
+        case '\t': return "\\t"sv;
+        case '"': return "\\\""sv;
+        case '\\': return "\\\\"sv;
+        default: return {};
+    }
+}
+
+}  // namespace json::detail
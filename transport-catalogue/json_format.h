@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+// Форматирование скаляров, общее для json::Print и json::Writer
+namespace json::detail {
+
+// Места достаточно для любого числа, которое пишут FormatInt и FormatDouble
+constexpr size_t kMaxNumberLength = 32;
+
+// Пишут число в buffer и возвращают конец записанного. Double печатается так же,
+// как operator<< с точностью по умолчанию (printf "%g")
+char* FormatInt(int value, char* buffer);
+char* FormatDouble(double value, char* buffer);
+
+// Первый символ в [begin, end), который в строке JSON экранируется, или end
+const char* FindEscape(const char* begin, const char* end);
+// Запись такого символа в строке JSON
+std::string_view GetEscape(char c);
+
+// Пишет символы строки с экранированием, без кавычек, через sink(std::string_view):
+// куски без экранирования передаются целиком, а не по символу
+template <typename Sink>
+void WriteEscapedChars(std::string_view value, Sink&& sink) {
+    const char* begin = value.data();
+    const char* const end = begin + value.size();
+    while (true) {
+        const char* special = FindEscape(begin, end);
+        if (special != begin) {
+            sink(std::string_view(begin, static_cast<size_t>(special - begin)));
+        }
+        if (special == end) {
+            break;
+        }
+        sink(GetEscape(*special));
+        begin = special + 1;
+    }
+}
+
+// То же в кавычках
+template <typename Sink>
+void WriteEscaped(std::string_view value, Sink&& sink) {
+    using namespace std::literals;
+    sink("\""sv);
+    WriteEscapedChars(value, sink);
+    sink("\""sv);
+}
+
+}  // namespace json::detail
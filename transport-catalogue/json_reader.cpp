@@ -1,10 +1,15 @@
 #include "json_reader.h"
+#include "json_cbor.h"
 #include "json_builder.h"
+#include "json_writer.h"
 #include "request_handler.h"
 #include "transport_catalogue.h"
 #include "transport_router.h"
 #include "map_renderer.h"
+#include "thread_pool.h"
 #include <sstream>
+#include <deque>
+#include <exception>
 #include <algorithm>
 #include <vector>
 #include <string>
@@ -12,24 +17,435 @@
 #include <optional>
 #include <stdexcept>
 #include <iomanip>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 namespace json_reader {
 
+namespace {
+
+// Сколько имён возвращает Suggest без явного count
+constexpr int kDefaultSuggestCount = 10;
+
+// Не больше стольких потоков разбирают base_requests, и на поток приходится не
+// меньше kMinParsePartSize байт: запуск потока дороже разбора маленького куска
+constexpr size_t kMaxParseThreads = 8;
+constexpr size_t kMinParsePartSize = 1 << 20;
+
+// Разобранные элементы base_requests: каталог заполняется потом, в порядке
+// документа. Расстояния и маршруты применяются после всех остановок, потому что
+// могут ссылаться на остановки, описанные ниже. Имена указывают в буфер
+// документа (или в json::Reader, который разбирал элемент)
+struct PendingStop {
+    std::string_view name;
+    double latitude;
+    double longitude;
+};
+
+struct PendingDistance {
+    std::string_view from;
+    std::string_view to;
+    int distance;
+};
+
+struct PendingBus {
+    std::string_view name;
+    std::vector<std::string_view> stops;
+    bool is_roundtrip;
+};
+
+struct BaseRequestBatch {
+    std::vector<PendingStop> stops;
+    std::vector<PendingDistance> distances;
+    std::vector<PendingBus> buses;
+    // Сколько элементов base_requests прочитано в пакет: по ним находится номер ошибочного
+    size_t request_count = 0;
+};
+
+// Номер элемента в base_requests попадает в сообщение, иначе ошибку в большой базе не найти
+std::invalid_argument MakeBaseRequestError(size_t index, std::string_view message) {
+    return std::invalid_argument("base_requests[" + std::to_string(index) + "]: " + std::string(message));
+}
+
+// Элементов base_requests в пакетах [0, end)
+size_t CountBaseRequests(const std::vector<BaseRequestBatch>& batches, size_t end) {
+    size_t count = 0;
+    for (size_t i = 0; i < end; ++i) {
+        count += batches[i].request_count;
+    }
+    return count;
+}
+
+// Ошибка разбора последнего элемента в batches[batch]: неполный запрос дополняется
+// номером элемента во всём документе, остальные (синтаксис JSON) пробрасываются как есть
+[[noreturn]] void RethrowBaseRequestError(std::exception_ptr error, const std::vector<BaseRequestBatch>& batches,
+                                          size_t batch) {
+    try {
+        std::rethrow_exception(error);
+    } catch (const std::invalid_argument& e) {
+        throw MakeBaseRequestError(CountBaseRequests(batches, batch + 1) - 1, e.what());
+    }
+}
+
+// Один элемент base_requests. Ключи могут идти в любом порядке, поэтому остановка
+// добавляется, когда словарь дочитан до конца
+void ReadBaseRequest(json::Reader& reader, BaseRequestBatch& batch) {
+    std::optional<std::string_view> type;
+    std::optional<std::string_view> name;
+    std::optional<double> latitude;
+    std::optional<double> longitude;
+    std::optional<bool> is_roundtrip;
+    std::vector<std::string_view> stops;
+    bool has_stops = false;
+    const size_t first_distance = batch.distances.size();
+    ++batch.request_count;
+
+    reader.BeginDict();
+    for (std::string_view key; reader.NextKey(key);) {
+        if (key == "type") {
+            type = reader.ReadString();
+        } else if (key == "name") {
+            name = reader.ReadString();
+        } else if (key == "latitude") {
+            latitude = reader.ReadDouble();
+        } else if (key == "longitude") {
+            longitude = reader.ReadDouble();
+        } else if (key == "is_roundtrip") {
+            is_roundtrip = reader.ReadBool();
+        } else if (key == "road_distances") {
+            reader.BeginDict();
+            for (std::string_view neighbor; reader.NextKey(neighbor);) {
+                batch.distances.push_back({{}, neighbor, reader.ReadInt()});
+            }
+        } else if (key == "stops") {
+            has_stops = true;
+            reader.BeginArray();
+            while (reader.NextItem()) {
+                stops.push_back(reader.ReadString());
+            }
+        } else {
+            reader.Skip();
+        }
+    }
+
+    if (!type) {
+        throw std::invalid_argument("Base request requires type");
+    }
+    if (type == "Stop") {
+        if (!name || !latitude || !longitude) {
+            throw std::invalid_argument("Stop request requires name, latitude and longitude");
+        }
+        batch.stops.push_back({*name, *latitude, *longitude});
+        for (size_t i = first_distance; i < batch.distances.size(); ++i) {
+            batch.distances[i].from = *name;
+        }
+        return;
+    }
+    batch.distances.resize(first_distance);
+    if (type == "Bus") {
+        if (!name || !has_stops || !is_roundtrip) {
+            throw std::invalid_argument("Bus request requires name, stops and is_roundtrip");
+        }
+        batch.buses.push_back({*name, std::move(stops), *is_roundtrip});
+    }
+}
+
+// Куски base_requests из Reader::SplitArray разбираются параллельно, каждый своим
+// Reader: он хранит строки с экранированием, поэтому readers живут, пока каталог
+// не заполнен. Первый кусок разбирается в вызывающем потоке. Ошибка в любом
+// куске пробрасывается после того, как все потоки завершились
+void ReadBaseRequestParts(const std::vector<std::string_view>& parts, std::deque<json::Reader>& readers,
+                          std::vector<BaseRequestBatch>& batches) {
+    const size_t first = batches.size();
+    batches.resize(first + parts.size());
+    std::vector<std::exception_ptr> errors(parts.size());
+    for (const auto part : parts) {
+        readers.emplace_back(part);
+    }
+
+    auto read_part = [&, first_reader = readers.size() - parts.size()](size_t index) {
+        try {
+            json::Reader& reader = readers[first_reader + index];
+            reader.BeginPart();
+            while (reader.NextPartItem()) {
+                ReadBaseRequest(reader, batches[first + index]);
+            }
+        } catch (...) {
+            errors[index] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t index = 1; index < parts.size(); ++index) {
+        threads.emplace_back(read_part, index);
+    }
+    if (!parts.empty()) {
+        read_part(0);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t index = 0; index < errors.size(); ++index) {
+        if (errors[index]) {
+            RethrowBaseRequestError(errors[index], batches, first + index);
+        }
+    }
+}
+
+// Всё, что нужно для ответа на stat_requests
+struct RequestContext {
+    const catalogue::TransportCatalogue& catalogue;
+    const request_handler::MapCache& map;
+    const LazyRouter& router;
+    request_handler::RequestHandler handler;
+};
+
+// Пишет ответ на один stat_request; запросы без id или type пропускаются (возвращается false)
+bool WriteResponse(const json::Node& request, const RequestContext& context, json::Writer& writer) {
+    if (!request.IsDict()) {
+        return false;
+    }
+
+    const auto& req = request.AsDict();
+    if (!req.count(json::keys::kId) || !req.count(json::keys::kType)) {
+        return false;
+    }
+
+    int request_id = req.at(json::keys::kId).AsInt();
+    const std::string& type = req.at(json::keys::kType).AsString();
+
+    if (type == "Bus") {
+        if (!req.count(json::keys::kName)) {
+            request_handler::WriteError(request_id, "not found", writer);
+        } else {
+            context.handler.WriteBusInfo(req.at(json::keys::kName).AsString(), request_id, writer);
+        }
+
+    } else if (type == "Stop") {
+        if (!req.count(json::keys::kName)) {
+            request_handler::WriteError(request_id, "not found", writer);
+        } else {
+            context.handler.WriteStopInfo(req.at(json::keys::kName).AsString(), request_id, writer);
+        }
+
+    } else if (type == "Map") {
+        writer.StartDict()
+              .Key("map").Value(context.map.Get())
+              .Key("request_id").Value(request_id)
+              .EndDict();
+
+    } else if (type == "Route") {
+        const auto route = context.router.Get().GetRoute(req.at(json::keys::kFrom).AsString(), req.at(json::keys::kTo).AsString());
+        if (!route) {
+            request_handler::WriteError(request_id, "not found", writer);
+            return true;
+        }
+
+        auto items = writer.StartDict().Key("items").StartArray();
+        for (const auto& item : route->items) {
+            if (item.type == "Wait") {
+                items.StartDict()
+                     .Key("stop_name").Value(item.stop_name)
+                     .Key("time").Value(item.time)
+                     .Key("type").Value("Wait")
+                     .EndDict();
+            } else if (item.type == "Bus") {
+                items.StartDict()
+                     .Key("bus").Value(item.bus)
+                     .Key("span_count").Value(item.span_count)
+                     .Key("time").Value(item.time)
+                     .Key("type").Value("Bus")
+                     .EndDict();
+            }
+        }
+        items.EndArray()
+             .Key("request_id").Value(request_id)
+             .Key("total_time").Value(route->total_time)
+             .EndDict();
+
+    } else if (type == "Suggest") {
+        const int count = req.count("count") ? req.at("count").AsInt() : kDefaultSuggestCount;
+        if (!req.count("prefix") || count < 0) {
+            request_handler::WriteError(request_id, "invalid request", writer);
+        } else {
+            context.handler.WriteSuggestions(req.at("prefix").AsString(), static_cast<size_t>(count),
+                                             request_id, writer);
+        }
+
+    } else if (type == "Nearby") {
+        // Нужны координаты и хотя бы одно из ограничений: count ближайших или radius в метрах
+        const bool has_limit = req.count("count") || req.count("radius");
+        const int count = req.count("count") ? req.at("count").AsInt() : 0;
+        const double radius = req.count("radius") ? req.at("radius").AsDouble()
+                                                  : std::numeric_limits<double>::infinity();
+        if (!req.count(json::keys::kLatitude) || !req.count(json::keys::kLongitude) || !has_limit || count < 0 || radius < 0) {
+            request_handler::WriteError(request_id, "invalid request", writer);
+        } else {
+            const geo::Coordinates center{req.at(json::keys::kLatitude).AsDouble(), req.at(json::keys::kLongitude).AsDouble()};
+            context.handler.WriteNearbyStops(center, static_cast<size_t>(count), radius, request_id, writer);
+        }
+
+    } else {
+        request_handler::WriteError(request_id, "unknown request type", writer);
+    }
+    return true;
+}
+
+// Сколько запросов отвечается параллельно за раз: ответы пакета хранятся до
+// печати, так что память ограничена пакетом, а первые ответы не ждут конца входа
+constexpr size_t kResponseBatchSize = 1024;
+
+// ParallelFor нельзя вызывать из двух потоков сразу: пакет, пришедший, пока пул
+// занят другим документом, отвечается в своём потоке. Мьютекс защищает и сам пул
+std::mutex response_pool_mutex;
+size_t response_threads = 0;
+std::unique_ptr<thread_pool::ThreadPool> response_pool;
+
+// Пул для ответов, один на процесс: потоки запускаются при первом большом пакете
+// и не пересоздаются на каждый документ. Вызывается под response_pool_mutex
+thread_pool::ThreadPool& GetResponsePool() {
+    if (!response_pool) {
+        response_pool = std::make_unique<thread_pool::ThreadPool>(response_threads);
+    }
+    return *response_pool;
+}
+
+// Печатает ответы по одному и сразу отдаёт их в output; буфер переиспользуется,
+// так что на ответ не выделяется память. Полный пакет запросов отвечается в пуле:
+// каждый ответ пишется в свою ячейку, а печатаются они по порядку запросов
+class ResponsePrinter {
+public:
+    ResponsePrinter(const RequestContext& context, std::ostream& output, json::Format format = json::Format::kText)
+        : context_(context)
+        , output_(output)
+        , format_(format)
+        , writer_(buffer_, format)
+        , responses_(writer_.StartArray()) {
+    }
+
+    void Print(const json::Node& request) {
+        WriteResponse(request, context_, writer_);
+        Flush();
+    }
+
+    void PrintAll(const json::Array& requests) {
+        for (auto it = requests.begin(); it != requests.end();) {
+            const auto batch_end = it + std::min<std::ptrdiff_t>(kResponseBatchSize, requests.end() - it);
+            PrintBatch(it, batch_end);
+            it = batch_end;
+        }
+    }
+
+    // Исключение из запроса пробрасывается после того, как напечатаны ответы
+    // на запросы перед ним, — как при ответах по одному
+    template <typename It>
+    void PrintBatch(It begin, It end) {
+        const auto count = static_cast<size_t>(std::distance(begin, end));
+        // Неполный пакет (обычно несколько запросов из потока) дешевле ответить
+        // сразу, чем будить потоки пула
+        std::unique_lock pool_lock(response_pool_mutex, std::defer_lock);
+        if (count < kResponseBatchSize || !pool_lock.try_lock() || GetResponsePool().GetThreadCount() == 1) {
+            for (; begin != end; ++begin) {
+                Print(*begin);
+            }
+            return;
+        }
+        thread_pool::ThreadPool& pool = GetResponsePool();
+
+        slots_.resize(std::max(slots_.size(), count));
+        errors_.assign(count, nullptr);
+        pool.ParallelFor(count, [this, begin](size_t index) {
+            std::string& slot = slots_[index];
+            slot.clear();
+            try {
+                json::Writer writer(slot, format_, 1);
+                WriteResponse(*std::next(begin, static_cast<std::ptrdiff_t>(index)), context_, writer);
+            } catch (...) {
+                errors_[index] = std::current_exception();
+            }
+        });
+
+        for (size_t index = 0; index < count; ++index) {
+            if (errors_[index]) {
+                Flush();
+                std::rethrow_exception(errors_[index]);
+            }
+            if (!slots_[index].empty()) {
+                responses_.Append(slots_[index]);
+            }
+        }
+        Flush();
+    }
+
+    void Finish() {
+        responses_.EndArray();
+        Flush();
+    }
+
+private:
+    void Flush() {
+        output_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
+    }
+
+    const RequestContext& context_;
+    std::ostream& output_;
+    json::Format format_;
+    std::string buffer_;
+    json::Writer writer_;
+    json::ArrayItemWriter<json::Writer> responses_;
+    // Ячейки ответов пакета; строки переиспользуются от пакета к пакету
+    std::vector<std::string> slots_;
+    std::vector<std::exception_ptr> errors_;
+};
+
+bool HasRouteRequests(const json::Document& doc) {
+    const auto& root = doc.GetRoot().AsDict();
+    if (!root.count("stat_requests")) {
+        return false;
+    }
+    const auto& requests = root.at("stat_requests").AsArray();
+    return std::any_of(requests.begin(), requests.end(), [](const json::Node& request) {
+        if (!request.IsDict()) {
+            return false;
+        }
+        const auto it = request.AsDict().find(json::keys::kType);
+        return it != request.AsDict().end() && it->second.IsString() && it->second.AsString() == "Route";
+    });
+}
+
+void PrintResponses(const json::Document& doc, const RequestContext& context, std::ostream& output,
+                    json::Format format) {
+    ResponsePrinter printer(context, output, format);
+    const auto& root = doc.GetRoot().AsDict();
+    if (root.count("stat_requests")) {
+        printer.PrintAll(root.at("stat_requests").AsArray());
+    }
+    printer.Finish();
+}
+
+}  // namespace
+
 InputData ParseInputData(const json::Document& doc) {
     InputData input;
     const auto& root = doc.GetRoot().AsDict();
     const auto& base_requests = root.at("base_requests").AsArray();
     
-    for (const auto& node : base_requests) {
-        const auto& obj = node.AsDict();
-        std::string type = obj.at("type").AsString();
+    for (size_t index = 0; index < base_requests.size(); ++index) {
+        const auto& obj = base_requests[index].AsDict();
+        if (!obj.count(json::keys::kType)) {
+            throw MakeBaseRequestError(index, "Base request requires type");
+        }
+        std::string type = obj.at(json::keys::kType).AsString();
         if (type == "Stop") {
             StopData stop;
-            stop.name = obj.at("name").AsString();
-            stop.latitude = obj.at("latitude").AsDouble();
-            stop.longitude = obj.at("longitude").AsDouble();
-            if (obj.count("road_distances") > 0) {
-                const auto& distances = obj.at("road_distances").AsDict();
+            stop.name = obj.at(json::keys::kName).AsString();
+            stop.latitude = obj.at(json::keys::kLatitude).AsDouble();
+            stop.longitude = obj.at(json::keys::kLongitude).AsDouble();
+            if (obj.count(json::keys::kRoadDistances) > 0) {
+                const auto& distances = obj.at(json::keys::kRoadDistances).AsDict();
                 for (const auto& [neighbor, distance_node] : distances) {
                     stop.road_distances[neighbor] = distance_node.AsInt();
                 }
@@ -37,9 +453,9 @@ InputData ParseInputData(const json::Document& doc) {
             input.stops.push_back(std::move(stop));
         } else if (type == "Bus") {
             BusData bus;
-            bus.name = obj.at("name").AsString();
-            bus.is_roundtrip = obj.at("is_roundtrip").AsBool();
-            const auto& stops_array = obj.at("stops").AsArray();
+            bus.name = obj.at(json::keys::kName).AsString();
+            bus.is_roundtrip = obj.at(json::keys::kIsRoundtrip).AsBool();
+            const auto& stops_array = obj.at(json::keys::kStops).AsArray();
             for (const auto& stop_node : stops_array) {
                 bus.stops.push_back(stop_node.AsString());
             }
@@ -52,6 +468,66 @@ InputData ParseInputData(const json::Document& doc) {
     return input;
 }
 
+json::Document LoadBaseRequests(std::string_view text, catalogue::TransportCatalogue& catalogue,
+                                size_t max_threads) {
+    // CBOR разбирается в дерево быстрее, чем текст читается потоково
+    if (json::IsCbor(text)) {
+        auto doc = json::Load(text);
+        FillTransportCatalogue(ParseInputData(doc), catalogue);
+        return doc;
+    }
+
+    json::Reader reader(text);
+    json::Dict rest;
+    std::deque<json::Reader> part_readers;
+    std::vector<BaseRequestBatch> batches;
+    const size_t threads = std::clamp<size_t>(max_threads != 0 ? max_threads : std::thread::hardware_concurrency(),
+                                              1, kMaxParseThreads);
+
+    reader.BeginDict();
+    for (std::string_view key; reader.NextKey(key);) {
+        if (key == "base_requests") {
+            const size_t max_parts = std::clamp<size_t>(reader.GetRest().size() / kMinParsePartSize, 1, threads);
+            if (max_parts > 1) {
+                ReadBaseRequestParts(reader.SplitArray(max_parts), part_readers, batches);
+            } else {
+                // В один поток предварительный проход по массиву не окупается
+                auto& batch = batches.emplace_back();
+                reader.BeginArray();
+                try {
+                    while (reader.NextItem()) {
+                        ReadBaseRequest(reader, batch);
+                    }
+                } catch (...) {
+                    RethrowBaseRequestError(std::current_exception(), batches, batches.size() - 1);
+                }
+            }
+        } else {
+            rest.emplace(std::string(key), reader.ReadNode());
+        }
+    }
+
+    // Тот же порядок, что у FillTransportCatalogue: остановки, расстояния, маршруты.
+    // Куски идут в порядке документа, так что каталог не зависит от числа потоков
+    for (const auto& batch : batches) {
+        for (const auto& [name, latitude, longitude] : batch.stops) {
+            catalogue.AddStop(name, latitude, longitude);
+        }
+    }
+    for (const auto& batch : batches) {
+        for (const auto& [from, to, distance] : batch.distances) {
+            catalogue.SetDistance(from, to, distance);
+        }
+    }
+    for (const auto& batch : batches) {
+        for (const auto& bus : batch.buses) {
+            catalogue.AddBus(bus.name, bus.stops, bus.is_roundtrip);
+        }
+    }
+    catalogue.Freeze();
+    return json::Document(json::Node(std::move(rest)));
+}
+
 RoutingSettings ParseRoutingSettings(const json::Document& doc) {
     RoutingSettings settings;
     const auto& root = doc.GetRoot().AsDict();
@@ -61,22 +537,104 @@ RoutingSettings ParseRoutingSettings(const json::Document& doc) {
     return settings;
 }
 
+std::filesystem::path ParseSerializationSettings(const json::Document& doc) {
+    const auto& root = doc.GetRoot().AsDict();
+    return root.at("serialization_settings").AsDict().at("file").AsString();
+}
+
 void FillTransportCatalogue(const InputData& input, catalogue::TransportCatalogue& catalogue) {
     for (const auto& stop : input.stops) {
         catalogue.AddStop(stop.name, stop.latitude, stop.longitude);
     }
     for (const auto& stop : input.stops) {
         for (const auto& [neighbor, distance] : stop.road_distances) {
-            catalogue.AddDistance(stop.name, neighbor, distance);
+            catalogue.SetDistance(stop.name, neighbor, distance);
         }
     }
     for (const auto& bus : input.buses) {
-        std::vector<std::string_view> bus_stops;
-        for (const auto& stop : bus.stops) {
-            bus_stops.push_back(stop);
-        }
-        catalogue.AddBus(bus.name, bus_stops, bus.is_roundtrip);
+        catalogue.AddBus(bus.name, bus.stops, bus.is_roundtrip);
+    }
+    catalogue.Freeze();
+}
+
+catalogue::Invalidation ApplyDeltaRequests(const json::Document& doc, catalogue::TransportCatalogue& catalogue) {
+    catalogue::Invalidation invalidation;
+    const auto& root = doc.GetRoot().AsDict();
+    if (!root.count("delta_requests")) {
+        return invalidation;
     }
+    const auto& delta_requests = root.at("delta_requests").AsArray();
+
+    auto is_removal = [](const json::Dict& obj) {
+        return obj.count("remove") && obj.at("remove").AsBool();
+    };
+    auto for_each_request = [&delta_requests](std::string_view type, auto action) {
+        for (const auto& node : delta_requests) {
+            const auto& obj = node.AsDict();
+            if (obj.at(json::keys::kType).AsString() == type) {
+                action(obj);
+            }
+        }
+    };
+
+    // Тот же порядок, что и при заполнении: удаление маршрутов, остановки, расстояния,
+    // маршруты и в конце удаление остановок
+    for_each_request("Bus", [&](const json::Dict& obj) {
+        if (is_removal(obj)) {
+            catalogue.RemoveBus(obj.at(json::keys::kName).AsString(), invalidation);
+        }
+    });
+    for_each_request("Stop", [&](const json::Dict& obj) {
+        if (!is_removal(obj)) {
+            catalogue.UpsertStop(obj.at(json::keys::kName).AsString(), obj.at(json::keys::kLatitude).AsDouble(),
+                                 obj.at(json::keys::kLongitude).AsDouble(), invalidation);
+        }
+    });
+    for_each_request("Stop", [&](const json::Dict& obj) {
+        if (!is_removal(obj) && obj.count(json::keys::kRoadDistances)) {
+            for (const auto& [neighbor, distance] : obj.at(json::keys::kRoadDistances).AsDict()) {
+                catalogue.UpdateDistance(obj.at(json::keys::kName).AsString(), neighbor, distance.AsInt(), invalidation);
+            }
+        }
+    });
+    for_each_request("Bus", [&](const json::Dict& obj) {
+        if (!is_removal(obj)) {
+            std::vector<std::string_view> stops;
+            for (const auto& stop : obj.at(json::keys::kStops).AsArray()) {
+                stops.push_back(stop.AsString());
+            }
+            catalogue.UpsertBus(obj.at(json::keys::kName).AsString(), stops, obj.at(json::keys::kIsRoundtrip).AsBool(), invalidation);
+        }
+    });
+    for_each_request("Stop", [&](const json::Dict& obj) {
+        if (is_removal(obj)) {
+            catalogue.RemoveStop(obj.at(json::keys::kName).AsString(), invalidation);
+        }
+    });
+    catalogue.Freeze();
+    return invalidation;
+}
+
+json::Document MakeInvalidationReport(const catalogue::Invalidation& invalidation, size_t changed_route_edges) {
+    auto names = [](const std::set<std::string_view>& values) {
+        json::Array result;
+        for (std::string_view value : values) {
+            result.emplace_back(std::string(value));
+        }
+        return result;
+    };
+    return json::Document(json::Builder{}
+        .StartDict()
+            .Key("added_buses").Value(names(invalidation.added_buses))
+            .Key("added_stops").Value(names(invalidation.added_stops))
+            .Key("changed_buses").Value(names(invalidation.changed_buses))
+            .Key("changed_stops").Value(names(invalidation.changed_stops))
+            .Key("map_changed").Value(invalidation.map_changed)
+            .Key("removed_buses").Value(names(invalidation.removed_buses))
+            .Key("removed_stops").Value(names(invalidation.removed_stops))
+            .Key("route_edges_changed").Value(static_cast<int>(changed_route_edges))
+        .EndDict()
+        .Build());
 }
 
 renderer::RenderSettings ParseRenderSettings(const json::Document& doc) {
@@ -161,137 +719,122 @@ renderer::RenderSettings ParseRenderSettings(const json::Document& doc) {
     return settings;
 }
 
-json::Document ProcessRequests(const json::Document& doc,
-                               const catalogue::TransportCatalogue& catalogue,
-                               const renderer::RenderSettings& render_settings) {
-    json::Builder builder;
-    builder.StartArray();
-
-    const auto& root = doc.GetRoot().AsDict();
-
+void ProcessRequests(const json::Document& doc,
+                     const catalogue::TransportCatalogue& catalogue,
+                     const renderer::RenderSettings& render_settings,
+                     std::ostream& output,
+                     json::Format format) {
     RoutingSettings routing_settings;
-    if (root.count("routing_settings")) {
-        const auto& routing = root.at("routing_settings").AsDict();
-        routing_settings.bus_wait_time = routing.at("bus_wait_time").AsInt();
-        routing_settings.bus_velocity = routing.at("bus_velocity").AsDouble();
+    if (doc.GetRoot().AsDict().count("routing_settings")) {
+        routing_settings = ParseRoutingSettings(doc);
     }
 
-    std::vector<const domain::Stop*> stops;
-        for (const auto& [name, stop_ptr] : catalogue.GetAllStops()) {
-            stops.push_back(stop_ptr);  
-        }
+    // Граф и матрица путей — самая дорогая часть старта; нужны они только Route.
+    // Если такие запросы есть, роутер строится в фоне, пока отвечаются остальные
+    LazyRouter router(catalogue, routing_settings);
+    if (HasRouteRequests(doc)) {
+        router.StartBuild();
+    }
+    const request_handler::MapCache map(catalogue, render_settings);
+    PrintResponses(doc, RequestContext{catalogue, map, router, request_handler::RequestHandler(catalogue)},
+                   output, format);
+}
 
+void SetResponseThreads(size_t threads) {
+    std::lock_guard guard(response_pool_mutex);
+    response_threads = threads;
+    response_pool.reset();
+}
 
-    std::vector<TransportRouter::Bus> buses;
-        for (const auto& [_, bus_ptr] : catalogue.GetAllBuses()) {
-            TransportRouter::Bus b;
-            b.name = std::string(bus_ptr->name);
-            for (const auto& stop : bus_ptr->stops) {
-                b.stops.push_back(std::string(stop));
-            }
-            b.is_roundtrip = bus_ptr->is_roundtrip;
-            buses.push_back(std::move(b));
-        }
+bool ProcessRequest(const json::Node& request, const catalogue::TransportCatalogue& catalogue,
+                    const request_handler::MapCache& map, const TransportRouter& router,
+                    json::Writer& writer) {
+    const LazyRouter ready_router(router);
+    return WriteResponse(request, RequestContext{catalogue, map, ready_router,
+                                                 request_handler::RequestHandler(catalogue)}, writer);
+}
 
+void ProcessRequests(const json::Document& doc,
+                     const catalogue::TransportCatalogue& catalogue,
+                     const request_handler::MapCache& map,
+                     const TransportRouter& router,
+                     std::ostream& output,
+                     json::Format format) {
+    const LazyRouter ready_router(router);
+    PrintResponses(doc, RequestContext{catalogue, map, ready_router,
+                                       request_handler::RequestHandler(catalogue)},
+                   output, format);
+}
 
-    TransportRouter router;
-    router.BuildGraph(stops, buses, routing_settings, catalogue);
+RequestStream::RequestStream(json::StreamReader& input)
+    : input_(input) {
+    input_.BeginDict();
+    ReadSections();
+}
 
-    if (!root.count("stat_requests")) {
-        return json::Document(builder.EndArray().Build());
-    }
+bool RequestStream::HasSection(const std::string& name) const {
+    return sections_.count(name) > 0;
+}
 
-    const auto& stat_requests = root.at("stat_requests").AsArray();
-    request_handler::RequestHandler handler(catalogue);
-    std::ostringstream map_output;
+json::Document RequestStream::GetSections() const {
+    return json::Document(json::Node(sections_));
+}
 
-    for (const auto& request : stat_requests) {
-        if (!request.IsDict()) continue;
+void RequestStream::ReadAll() {
+    if (!at_requests_) {
+        return;
+    }
+    sections_.emplace("stat_requests", input_.ReadNode());
+    at_requests_ = false;
+    ReadSections();
+}
 
-        const auto& req = request.AsDict();
-        if (!req.count("id") || !req.count("type")) continue;
+void RequestStream::ReadSections() {
+    for (std::string key; input_.NextKey(key);) {
+        if (key == "stat_requests" && !sections_.count(key)) {
+            at_requests_ = true;
+            return;
+        }
+        if (sections_.count(key)) {
+            throw json::ParsingError("Duplicate key '" + key + "' have been found");
+        }
+        sections_.emplace(std::move(key), input_.ReadNode());
+    }
+}
 
-        int request_id = req.at("id").AsInt();
-        const std::string& type = req.at("type").AsString();
+void RequestStream::Answer(const catalogue::TransportCatalogue& catalogue,
+                           const request_handler::MapCache& map, const TransportRouter& router,
+                           std::ostream& output) {
+    const LazyRouter ready_router(router);
+    const RequestContext context{catalogue, map, ready_router, request_handler::RequestHandler(catalogue)};
+    ResponsePrinter printer(context, output);
 
-        if (type == "Bus") {
-            if (!req.count("name")) {
-                builder.StartDict()
-                       .Key("request_id").Value(request_id)
-                       .Key("error_message").Value("not found")
-                       .EndDict();
-                continue;
+    if (at_requests_) {
+        input_.BeginArray();
+        std::vector<json::Node> batch;
+        while (input_.NextItem()) {
+            batch.push_back(input_.ReadNode());
+            // Следующий запрос ещё не пришёл: пакет отвечается сразу, и готовые
+            // ответы не ждут в буфере
+            const bool waiting = !input_.HasBufferedInput();
+            if (waiting || batch.size() == kResponseBatchSize) {
+                printer.PrintBatch(batch.begin(), batch.end());
+                batch.clear();
             }
-            std::string name = req.at("name").AsString();
-            builder.Value(handler.GetBusInfo(name, request_id));
-
-        } else if (type == "Stop") {
-            if (!req.count("name")) {
-                builder.StartDict()
-                       .Key("request_id").Value(request_id)
-                       .Key("error_message").Value("not found")
-                       .EndDict();
-                continue;
+            if (waiting) {
+                output.flush();
             }
-            std::string name = req.at("name").AsString();
-            builder.Value(handler.GetStopInfo(name, request_id));
-
-        } else if (type == "Map") {
-            map_output.str("");
-            renderer::RenderMap(catalogue, render_settings, map_output);
-            builder.StartDict()
-                   .Key("request_id").Value(request_id)
-                   .Key("map").Value(map_output.str())
-                   .EndDict();
-
-        } else if (type == "Route") {
-            std::string from = req.at("from").AsString();
-            std::string to = req.at("to").AsString();
-            auto route = router.GetRoute(from, to);
-
-            if (!route) {
-                builder.StartDict()
-                       .Key("request_id").Value(request_id)
-                       .Key("error_message").Value("not found")
-                       .EndDict();
-                continue;
-            }
-
-            builder.StartDict()
-                   .Key("request_id").Value(request_id)
-                   .Key("total_time").Value(route->total_time)
-                   .Key("items").StartArray();
-
-            for (const auto& item : route->items) {
-                if (item.type == "Wait") {
-                    builder.StartDict()
-                           .Key("type").Value("Wait")
-                           .Key("stop_name").Value(item.stop_name)
-                           .Key("time").Value(item.time)
-                           .EndDict();
-                } else if (item.type == "Bus") {
-                    builder.StartDict()
-                           .Key("type").Value("Bus")
-                           .Key("bus").Value(item.bus)
-                           .Key("span_count").Value(item.span_count)
-                           .Key("time").Value(item.time)
-                           .EndDict();
-                }
-            }
-
-            builder.EndArray().EndDict();
-
-        } else {
-            builder.StartDict()
-                   .Key("request_id").Value(request_id)
-                   .Key("error_message").Value("unknown request type")
-                   .EndDict();
         }
+        printer.PrintBatch(batch.begin(), batch.end());
+        at_requests_ = false;
+        // Ответы уже напечатаны; ключ остаётся, чтобы повтор stat_requests был ошибкой
+        sections_.emplace("stat_requests", json::Array{});
+        ReadSections();
+    } else if (sections_.count("stat_requests")) {
+        printer.PrintAll(sections_.at("stat_requests").AsArray());
     }
 
-    builder.EndArray();
-    return json::Document(builder.Build());
+    printer.Finish();
 }
 
-
 } // namespace json_reader
@@ -1,23 +1,31 @@
 #pragma once
 #include "json.h"
+#include "json_writer.h"
 #include "transport_catalogue.h"
 #include "map_renderer.h"
+#include "request_handler.h"
+#include "transport_router.h"
+#include <filesystem>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <map>
+#include <optional>
 
 namespace json_reader {
 
+// Строки указывают в разобранный документ, он должен жить дольше InputData.
+// Каталог копирует каждое имя в свою арену один раз.
 struct StopData {
-    std::string name;
+    std::string_view name;
     double latitude;
     double longitude;
-    std::map<std::string, int> road_distances;
+    std::map<std::string_view, int> road_distances;
 };
 
 struct BusData {
-    std::string name;
-    std::vector<std::string> stops;
+    std::string_view name;
+    std::vector<std::string_view> stops;
     bool is_roundtrip = false;
 };
 
@@ -29,9 +37,70 @@ struct InputData {
 
 InputData ParseInputData(const json::Document& doc);
 void FillTransportCatalogue(const InputData& input_data, catalogue::TransportCatalogue& catalogue);
+// Читает документ потоково: base_requests сразу заполняют каталог, без дерева и
+// промежуточных копий. Остальные разделы документа возвращаются обычным документом.
+// Большой массив base_requests делится на куски, которые разбираются в нескольких
+// потоках; каталог заполняется в порядке документа и от числа потоков не зависит.
+// Документ в CBOR разбирается целиком и возвращается вместе с base_requests.
+// max_threads — предел числа потоков разбора; 0 — по числу аппаратных потоков
+json::Document LoadBaseRequests(std::string_view text, catalogue::TransportCatalogue& catalogue,
+                                size_t max_threads = 0);
 
-json::Document ProcessRequests(const json::Document& doc, const catalogue::TransportCatalogue& catalogue, const renderer::RenderSettings& render_settings);
+// Применяет delta_requests к уже заполненному каталогу. Элемент delta_requests имеет формат
+// base_requests; с "remove": true остановка или маршрут удаляются
+catalogue::Invalidation ApplyDeltaRequests(const json::Document& doc, catalogue::TransportCatalogue& catalogue);
+json::Document MakeInvalidationReport(const catalogue::Invalidation& invalidation, size_t changed_route_edges);
+
+// Печатает ответы на stat_requests так же, как json::Print печатал бы их массив
+// (или тот же массив в формате format)
+void ProcessRequests(const json::Document& doc, const catalogue::TransportCatalogue& catalogue,
+                     const renderer::RenderSettings& render_settings, std::ostream& output,
+                     json::Format format = json::Format::kText);
+// По снимку базы: роутер готов, карта берётся из кэша снимка
+void ProcessRequests(const json::Document& doc, const catalogue::TransportCatalogue& catalogue,
+                     const request_handler::MapCache& map, const TransportRouter& router,
+                     std::ostream& output, json::Format format = json::Format::kText);
+
+// Сколько потоков отвечают на большие пакеты stat_requests; 0 — по числу аппаратных
+// потоков. Пул пересоздаётся при следующем пакете; вызов ждёт, пока текущий пакет допечатается
+void SetResponseThreads(size_t threads);
+
+// Пишет ответ на один stat_request очередным значением writer. Запрос без id или type
+// пропускается: ничего не пишется, возвращается false
+bool ProcessRequest(const json::Node& request, const catalogue::TransportCatalogue& catalogue,
+                    const request_handler::MapCache& map, const TransportRouter& router,
+                    json::Writer& writer);
+
+// Документ process_requests, читаемый из потока. Разделы до stat_requests читаются
+// сразу, а сами запросы — по одному в Answer: ответ на каждый печатается, как
+// только готов, так что память не зависит от размера пакета
+class RequestStream {
+public:
+    explicit RequestStream(json::StreamReader& input);
+
+    // Разделы документа, прочитанные к этому моменту
+    bool HasSection(const std::string& name) const;
+    json::Document GetSections() const;
+    // Дочитывает документ целиком вместе с запросами. Нужен, если раздел, без
+    // которого нельзя отвечать, идёт после stat_requests
+    void ReadAll();
+
+    // Печатает то же, что json::Print(ProcessRequests(...)), и дочитывает документ
+    void Answer(const catalogue::TransportCatalogue& catalogue, const request_handler::MapCache& map,
+                const TransportRouter& router, std::ostream& output);
+
+private:
+    // Читает разделы до stat_requests или до конца документа
+    void ReadSections();
+
+    json::StreamReader& input_;
+    json::Dict sections_;
+    // Поток стоит в начале массива stat_requests
+    bool at_requests_ = false;
+};
 
 renderer::RenderSettings ParseRenderSettings(const json::Document& doc);
+RoutingSettings ParseRoutingSettings(const json::Document& doc);
+std::filesystem::path ParseSerializationSettings(const json::Document& doc);
 
 } // namespace json_reader
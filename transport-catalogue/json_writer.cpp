@@ -0,0 +1,265 @@
+#include "json_writer.h"
+#include "json_cbor.h"
+#include "json_format.h"
+
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+
+namespace json {
+
+using namespace std::literals;
+
+namespace {
+
+// Буфер потока, который при каждом сбросе дописывает накопленный кусок в text и
+// его экранированный вид в escaped
+class EscapingBuffer : public std::streambuf {
+public:
+    EscapingBuffer(std::string& text, std::string& escaped)
+        : text_(text)
+        , escaped_(escaped) {
+        setp(buffer_.data(), buffer_.data() + buffer_.size());
+    }
+
+protected:
+    int_type overflow(int_type c) override {
+        Flush();
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override {
+        Flush();
+        return 0;
+    }
+
+private:
+    void Flush() {
+        const std::string_view chunk(pbase(), static_cast<size_t>(pptr() - pbase()));
+        text_ += chunk;
+        detail::WriteEscapedChars(chunk, [this](std::string_view part) {
+            escaped_ += part;
+        });
+        setp(buffer_.data(), buffer_.data() + buffer_.size());
+    }
+
+    std::string& text_;
+    std::string& escaped_;
+    std::array<char, 4096> buffer_;
+};
+
+}  // namespace
+
+EscapedString::EscapedString(const std::function<void(std::ostream&)>& write) {
+    escaped_ += '"';
+    EscapingBuffer buffer(text_, escaped_);
+    std::ostream output(&buffer);
+    write(output);
+    output.flush();
+    escaped_ += '"';
+}
+
+Writer::Writer(std::string& output, Format format)
+    : output_(output)
+    , format_(format) {
+}
+
+Writer::Writer(std::string& output, Format format, size_t depth)
+    : output_(output)
+    , format_(format)
+    , depth_(depth) {
+    if (depth > kMaxDepth) {
+        throw std::logic_error("JSON nesting is too deep"s);
+    }
+}
+
+void Writer::BeginValue() {
+    if (depth_ == 0) {
+        return;
+    }
+    Frame& frame = frames_[depth_ - 1];
+    if (frame.is_dict) {
+        // Контексты не дают записать значение без ключа; остаётся случай Writer::Value внутри словаря
+        if (!after_key_) {
+            throw std::logic_error("Value in a dictionary must follow a key"s);
+        }
+        after_key_ = false;
+        return;
+    }
+    if (format_ != Format::kCbor) {
+        if (!frame.empty) {
+            output_ += format_ == Format::kCompact ? ","sv : ",\n"sv;
+        }
+        WriteIndent(depth_);
+    }
+    frame.empty = false;
+}
+
+void Writer::OpenContainer(bool is_dict) {
+    BeginValue();
+    if (depth_ == kMaxDepth) {
+        throw std::logic_error("JSON nesting is too deep"s);
+    }
+    frames_[depth_++] = Frame{is_dict, true};
+    if (format_ == Format::kCbor) {
+        output_ += is_dict ? detail::kCborDictStart : detail::kCborArrayStart;
+        return;
+    }
+    output_ += is_dict ? '{' : '[';
+    if (format_ == Format::kText) {
+        output_ += '\n';
+    }
+}
+
+void Writer::CloseContainer(bool is_dict) {
+    if (depth_ == 0 || frames_[depth_ - 1].is_dict != is_dict || after_key_) {
+        throw std::logic_error("Unexpected end of a container"s);
+    }
+    --depth_;
+    if (format_ == Format::kCbor) {
+        output_ += detail::kCborBreak;
+        return;
+    }
+    if (format_ == Format::kText) {
+        output_ += '\n';
+    }
+    WriteIndent(depth_);
+    output_ += is_dict ? '}' : ']';
+}
+
+void Writer::WriteKey(std::string_view key) {
+    Frame& frame = frames_[depth_ - 1];
+    after_key_ = true;
+    if (format_ == Format::kCbor) {
+        frame.empty = false;
+        WriteString(key);
+        return;
+    }
+    if (!frame.empty) {
+        output_ += format_ == Format::kCompact ? ","sv : ",\n"sv;
+    }
+    frame.empty = false;
+    WriteIndent(depth_);
+    WriteString(key);
+    output_ += format_ == Format::kCompact ? ":"sv : ": "sv;
+}
+
+void Writer::AppendElement(std::string_view element) {
+    if (depth_ == 0 || frames_[depth_ - 1].is_dict) {
+        throw std::logic_error("Element must be appended to an array"s);
+    }
+    Frame& frame = frames_[depth_ - 1];
+    if (format_ != Format::kCbor && !frame.empty) {
+        output_ += format_ == Format::kCompact ? ","sv : ",\n"sv;
+    }
+    frame.empty = false;
+    output_ += element;
+}
+
+void Writer::WriteIndent(size_t depth) {
+    if (format_ == Format::kText) {
+        output_.append(depth * 4, ' ');
+    }
+}
+
+void Writer::WriteString(std::string_view value) {
+    if (format_ == Format::kCbor) {
+        detail::WriteCborText(value, output_);
+        return;
+    }
+    detail::WriteEscaped(value, [this](std::string_view part) {
+        output_ += part;
+    });
+}
+
+void Writer::WriteValue(std::nullptr_t) {
+    BeginValue();
+    if (format_ == Format::kCbor) {
+        output_ += detail::kCborNull;
+        return;
+    }
+    output_ += "null"sv;
+}
+
+void Writer::WriteValue(bool value) {
+    BeginValue();
+    if (format_ == Format::kCbor) {
+        output_ += value ? detail::kCborTrue : detail::kCborFalse;
+        return;
+    }
+    output_ += value ? "true"sv : "false"sv;
+}
+
+void Writer::WriteValue(int value) {
+    BeginValue();
+    if (format_ == Format::kCbor) {
+        detail::WriteCborInt(value, output_);
+        return;
+    }
+    char buffer[detail::kMaxNumberLength];
+    output_.append(buffer, detail::FormatInt(value, buffer));
+}
+
+// CBOR хранит double целиком, без округления до шести знаков, как в тексте
+void Writer::WriteValue(double value) {
+    BeginValue();
+    if (format_ == Format::kCbor) {
+        detail::WriteCborDouble(value, output_);
+        return;
+    }
+    char buffer[detail::kMaxNumberLength];
+    output_.append(buffer, detail::FormatDouble(value, buffer));
+}
+
+void Writer::WriteValue(std::string_view value) {
+    BeginValue();
+    WriteString(value);
+}
+
+void Writer::WriteValue(const char* value) {
+    WriteValue(std::string_view(value));
+}
+
+void Writer::WriteValue(const std::string& value) {
+    WriteValue(std::string_view(value));
+}
+
+// Готовый вид копируется целиком, без повторного экранирования
+void Writer::WriteValue(const EscapedString& value) {
+    BeginValue();
+    if (format_ == Format::kCbor) {
+        detail::WriteCborText(value.GetText(), output_);
+        return;
+    }
+    output_ += value.GetEscaped();
+}
+
+void Writer::WriteValue(const Node& node) {
+    if (node.IsArray()) {
+        OpenContainer(false);
+        for (const Node& item : node.AsArray()) {
+            WriteValue(item);
+        }
+        CloseContainer(false);
+    } else if (node.IsDict()) {
+        OpenContainer(true);
+        for (const auto& [key, value] : node.AsDict()) {
+            WriteKey(key);
+            WriteValue(value);
+        }
+        CloseContainer(true);
+    } else {
+        std::visit([this](const auto& value) {
+            using Value = std::decay_t<decltype(value)>;
+            if constexpr (!std::is_same_v<Value, Array> && !std::is_same_v<Value, Dict>) {
+                WriteValue(value);
+            }
+        }, node.GetValue());
+    }
+}
+
+}  // namespace json
@@ -0,0 +1,231 @@
+#pragma once
+
+#include "json.h"
+
+#include <array>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace json {
+
+class Writer;
+
+template <typename Parent>
+class DictItemWriter;
+template <typename Parent>
+class DictValueWriter;
+template <typename Parent>
+class ArrayItemWriter;
+
+namespace detail {
+
+// Куда возвращает End*: во внешний контекст или к самому Writer
+template <typename Parent>
+using WriterReturn = std::conditional_t<std::is_same_v<Parent, Writer>, Writer&, Parent>;
+
+}  // namespace detail
+
+enum class Format {
+    // Как у Print: по значению на строку, с отступами
+    kText,
+    // Текст в одну строку
+    kCompact,
+    // CBOR (см. json_cbor.h). Массивы и словари пишутся с неопределённой длиной,
+    // поэтому готовое начало документа можно отдавать, не дожидаясь конца
+    kCbor,
+};
+
+// Строка вместе с её видом в JSON: в кавычках и с экранированием. Длинную строку,
+// которую пишут много раз (например, карту), так экранируют один раз
+class EscapedString {
+public:
+    // Текст пишет write в переданный поток; обе формы растут по мере записи, за
+    // один проход, без промежуточной строки вроде ostringstream::str()
+    explicit EscapedString(const std::function<void(std::ostream&)>& write);
+
+    const std::string& GetText() const {
+        return text_;
+    }
+    const std::string& GetEscaped() const {
+        return escaped_;
+    }
+
+private:
+    std::string text_;
+    std::string escaped_;
+};
+
+// Запись JSON прямо в буфер, без дерева Node и без выделения памяти на значение.
+// Вывод тот же, что у Print (или в формате format), но ключи словаря
+// нужно передавать по возрастанию — в таком порядке их печатает Print из std::map.
+// Порядок вызовов проверяется при компиляции контекстами, как у Builder:
+// после Key нельзя вызвать Key или EndDict, в массиве нельзя вызвать Key и т. д.
+// Вложенность контекстов тоже известна типу, так что EndDict возвращает
+// ровно тот контекст, в котором словарь был начат.
+class Writer {
+public:
+    explicit Writer(std::string& output, Format format = Format::kText);
+    // Одно значение, которое потом вставят элементом массива на глубине depth
+    // через ArrayItemWriter::Append: отступы как на этой глубине, разделителя
+    // перед значением нет. Так элементы одного массива пишутся в разных потоках
+    Writer(std::string& output, Format format, size_t depth);
+
+    // Очередное значение: верхнего уровня или элемент открытого массива
+    DictItemWriter<Writer> StartDict();
+    ArrayItemWriter<Writer> StartArray();
+    template <typename T>
+    Writer& Value(const T& value) {
+        WriteValue(value);
+        return *this;
+    }
+
+private:
+    template <typename>
+    friend class DictItemWriter;
+    template <typename>
+    friend class DictValueWriter;
+    template <typename>
+    friend class ArrayItemWriter;
+
+    // Разделитель и отступ перед значением в текущем контейнере
+    void BeginValue();
+    void OpenContainer(bool is_dict);
+    void CloseContainer(bool is_dict);
+    void WriteKey(std::string_view key);
+    void AppendElement(std::string_view element);
+    void WriteIndent(size_t depth);
+    void WriteString(std::string_view value);
+
+    void WriteValue(std::nullptr_t);
+    void WriteValue(bool value);
+    void WriteValue(int value);
+    void WriteValue(double value);
+    void WriteValue(std::string_view value);
+    void WriteValue(const char* value);
+    void WriteValue(const std::string& value);
+    void WriteValue(const EscapedString& value);
+    void WriteValue(const Node& node);
+
+    // Глубже документы не бывают; фиксированный стек не выделяет память
+    static constexpr size_t kMaxDepth = 32;
+
+    struct Frame {
+        bool is_dict = false;
+        bool empty = true;
+    };
+
+    std::string& output_;
+    Format format_;
+    std::array<Frame, kMaxDepth> frames_;
+    size_t depth_ = 0;
+    bool after_key_ = false;
+};
+
+template <typename Parent>
+class DictItemWriter {
+public:
+    explicit DictItemWriter(Writer& writer)
+        : writer_(writer) {
+    }
+
+    DictValueWriter<Parent> Key(std::string_view key) {
+        writer_.WriteKey(key);
+        return DictValueWriter<Parent>(writer_);
+    }
+
+    detail::WriterReturn<Parent> EndDict() {
+        writer_.CloseContainer(true);
+        if constexpr (std::is_same_v<Parent, Writer>) {
+            return writer_;
+        } else {
+            return Parent(writer_);
+        }
+    }
+
+private:
+    Writer& writer_;
+};
+
+template <typename Parent>
+class DictValueWriter {
+public:
+    explicit DictValueWriter(Writer& writer)
+        : writer_(writer) {
+    }
+
+    template <typename T>
+    DictItemWriter<Parent> Value(const T& value) {
+        writer_.WriteValue(value);
+        return DictItemWriter<Parent>(writer_);
+    }
+
+    DictItemWriter<DictItemWriter<Parent>> StartDict() {
+        writer_.OpenContainer(true);
+        return DictItemWriter<DictItemWriter<Parent>>(writer_);
+    }
+
+    ArrayItemWriter<DictItemWriter<Parent>> StartArray() {
+        writer_.OpenContainer(false);
+        return ArrayItemWriter<DictItemWriter<Parent>>(writer_);
+    }
+
+private:
+    Writer& writer_;
+};
+
+template <typename Parent>
+class ArrayItemWriter {
+public:
+    explicit ArrayItemWriter(Writer& writer)
+        : writer_(writer) {
+    }
+
+    template <typename T>
+    ArrayItemWriter Value(const T& value) {
+        writer_.WriteValue(value);
+        return *this;
+    }
+
+    // Элемент, уже записанный Writer с той же глубиной и тем же форматом
+    ArrayItemWriter Append(std::string_view element) {
+        writer_.AppendElement(element);
+        return *this;
+    }
+
+    DictItemWriter<ArrayItemWriter> StartDict() {
+        writer_.OpenContainer(true);
+        return DictItemWriter<ArrayItemWriter>(writer_);
+    }
+
+    ArrayItemWriter<ArrayItemWriter> StartArray() {
+        writer_.OpenContainer(false);
+        return ArrayItemWriter<ArrayItemWriter>(writer_);
+    }
+
+    detail::WriterReturn<Parent> EndArray() {
+        writer_.CloseContainer(false);
+        if constexpr (std::is_same_v<Parent, Writer>) {
+            return writer_;
+        } else {
+            return Parent(writer_);
+        }
+    }
+
+private:
+    Writer& writer_;
+};
+
+inline DictItemWriter<Writer> Writer::StartDict() {
+    OpenContainer(true);
+    return DictItemWriter<Writer>(*this);
+}
+
+inline ArrayItemWriter<Writer> Writer::StartArray() {
+    OpenContainer(false);
+    return ArrayItemWriter<Writer>(*this);
+}
+
+}  // namespace json
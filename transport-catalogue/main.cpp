@@ -1,19 +1,243 @@
 #include "json_builder.h"
+#include "json_cbor.h"
 #include "json_reader.h"
+#include "json_writer.h"
 #include "json.h"
 #include "transport_catalogue.h"
+#include "transport_router.h"
 #include "map_renderer.h"
+#include "serialization.h"
+#include "snapshot.h"
+#include "server.h"
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <pthread.h>
+
+using namespace std::literals;
+
+namespace {
+
+void PrintUsage(std::ostream& stream = std::cerr) {
+    stream << "Usage: transport_catalogue [make_base|process_requests|update_base]\n"sv
+           << "       transport_catalogue serve <base_file> [<socket_path>]\n"sv;
+}
+
+// Вычитывает вход целиком: разбор по готовому буферу быстрее, чем из потока
+std::string ReadAll(std::istream& input) {
+    std::ostringstream buffer;
+    buffer << input.rdbuf();
+    return buffer.str();
+}
+
+// Строит каталог и роутер по base_requests и сохраняет их в бинарную базу
+void MakeBase(std::istream& input) {
+    catalogue::TransportCatalogue catalogue;
+    const auto doc = json_reader::LoadBaseRequests(ReadAll(input), catalogue);
+
+    TransportRouter router(catalogue, json_reader::ParseRoutingSettings(doc));
+    router.BuildGraph();
+
+    serialization::SaveBase(json_reader::ParseSerializationSettings(doc), catalogue,
+                            json_reader::ParseRenderSettings(doc), router);
+}
+
+bool HasMoreInput(std::istream& input) {
+    input >> std::ws;
+    return input.peek() != std::char_traits<char>::eof();
+}
+
+// Ответ в том же формате, в каком пришли запросы
+json::Format GetResponseFormat(std::string_view input) {
+    return json::IsCbor(input) ? json::Format::kCbor : json::Format::kText;
+}
+
+// process_requests для CBOR: потокового разбора у него нет, поэтому вход читается
+// целиком, а документы в нём (последовательность CBOR) обслуживаются по очереди
+void ProcessCborRequests(std::string_view input, std::ostream& output) {
+    snapshot::SnapshotHolder holder;
+    std::unique_ptr<snapshot::SnapshotLoader> loader;
+    while (!input.empty()) {
+        const auto doc = json::Load(input, &input);
+        if (!loader) {
+            loader = std::make_unique<snapshot::SnapshotLoader>(holder, json_reader::ParseSerializationSettings(doc));
+        }
+        const auto current = holder.Acquire();
+        json_reader::ProcessRequests(doc, current->catalogue, current->map, *current->router, output,
+                                     json::Format::kCbor);
+        output.flush();
+    }
+}
+
+// Отвечает на stat_requests по базе, отображённой в память. Во входе может
+// идти несколько документов подряд: база загружается по первому из них, а
+// фоновый загрузчик подхватывает её замену (например, после update_base),
+// не останавливая ответы. Каждый документ обслуживается одним снимком.
+// Запросы читаются из потока по одному, и ответ на каждый выводится сразу.
+// Текст JSON не начинается с байта больше 0x7F, а CBOR начинается
+void ProcessRequests(std::istream& input, std::ostream& output) {
+    if (const int first = input.peek(); first != std::char_traits<char>::eof() && first > 0x7F) {
+        ProcessCborRequests(ReadAll(input), output);
+        return;
+    }
+
+    snapshot::SnapshotHolder holder;
+    std::unique_ptr<snapshot::SnapshotLoader> loader;
+    json::StreamReader reader(input);
+
+    for (bool first = true; HasMoreInput(input); first = false) {
+        json_reader::RequestStream requests(reader);
+        if (!loader) {
+            // Без базы отвечать не на чем: если путь к ней идёт после запросов,
+            // первый документ приходится дочитать целиком
+            if (!requests.HasSection("serialization_settings")) {
+                requests.ReadAll();
+            }
+            loader = std::make_unique<snapshot::SnapshotLoader>(
+                holder, json_reader::ParseSerializationSettings(requests.GetSections()));
+        }
+        if (!first) {
+            output << '\n';
+        }
+
+        const auto current = holder.Acquire();
+        requests.Answer(current->catalogue, current->map, *current->router, output);
+        output.flush();
+    }
+}
+
+// Применяет delta_requests к сохранённой базе и выводит отчёт о том, что изменилось
+void UpdateBase(std::istream& input, std::ostream& output) {
+    const std::string text = ReadAll(input);
+    const auto doc = json::Load(text);
+    const auto path = json_reader::ParseSerializationSettings(doc);
 
-int main() {
-    auto doc = json::Load(std::cin);
-    
     catalogue::TransportCatalogue catalogue;
-    auto input_data = json_reader::ParseInputData(doc);
-    json_reader::FillTransportCatalogue(input_data, catalogue);
-    renderer::RenderSettings render_settings = json_reader::ParseRenderSettings(doc);
-    auto answer = json_reader::ProcessRequests(doc, catalogue, render_settings);
-    json::Print(answer, std::cout);
-    
+    renderer::RenderSettings render_settings;
+    std::unique_ptr<TransportRouter> router;
+    {
+        const serialization::MappedBase base(path);
+        base.FillCatalogue(catalogue);
+        render_settings = base.GetRenderSettings();
+        router = base.MakeRouter(catalogue);
+        router->Detach();
+    }
+
+    const auto invalidation = json_reader::ApplyDeltaRequests(doc, catalogue);
+    const size_t changed_edges = invalidation.IsEmpty() ? 0 : router->ApplyInvalidation(invalidation);
+    if (!invalidation.IsEmpty()) {
+        serialization::SaveBase(path, catalogue, render_settings, *router);
+    }
+    const auto report = json_reader::MakeInvalidationReport(invalidation, changed_edges);
+    if (const auto format = GetResponseFormat(text); format != json::Format::kText) {
+        std::string buffer;
+        json::Writer(buffer, format).Value(report.GetRoot());
+        output << buffer;
+    } else {
+        json::Print(report, output);
+    }
+}
+
+// Долгоживущий процесс: база загружается один раз (и подменяется загрузчиком),
+// запросы приходят JSON Lines из stdin или от клиентов Unix-сокета. При выходе
+// задержки по типам запросов выводятся в stderr
+void Serve(const std::filesystem::path& base_path, const char* socket_path) {
+    // Сигналы остановки принимает отдельный поток; маска ставится до запуска
+    // остальных потоков, чтобы они её унаследовали
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, nullptr);
+
+    snapshot::SnapshotHolder holder;
+    snapshot::SnapshotLoader loader(holder, base_path);
+    server::Server server(holder);
+
+    if (!socket_path) {
+        // Чтение stdin сигналом не прерывается, поэтому по сигналу поток сам выводит
+        // задержки и завершает процесс. Готовые ответы к этому времени уже в stdout:
+        // ServeStream сбрасывает вывод, когда следующей строки ещё нет
+        std::atomic<bool> input_done = false;
+        std::thread signal_waiter([&server, &stop_signals, &input_done] {
+            int signal = 0;
+            sigwait(&stop_signals, &signal);
+            if (!input_done) {
+                server.GetStats().Report(std::cerr);
+                std::_Exit(128 + signal);
+            }
+        });
+        try {
+            server.ServeStream(std::cin, std::cout);
+        } catch (...) {
+            input_done = true;
+            pthread_kill(signal_waiter.native_handle(), SIGTERM);
+            signal_waiter.join();
+            throw;
+        }
+        input_done = true;
+        pthread_kill(signal_waiter.native_handle(), SIGTERM);
+        signal_waiter.join();
+    } else {
+        std::thread signal_waiter([&server, &stop_signals] {
+            int signal = 0;
+            sigwait(&stop_signals, &signal);
+            server.Stop();
+        });
+        try {
+            server.ServeSocket(socket_path);
+        } catch (...) {
+            pthread_kill(signal_waiter.native_handle(), SIGTERM);
+            signal_waiter.join();
+            throw;
+        }
+        signal_waiter.join();
+    }
+    server.GetStats().Report(std::cerr);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    // Потоки не делят буфер с stdio, и документы из std::cin читаются блоками
+    std::ios::sync_with_stdio(false);
+
+    if (argc == 1) {
+        catalogue::TransportCatalogue catalogue;
+        const std::string text = ReadAll(std::cin);
+        const auto doc = json_reader::LoadBaseRequests(text, catalogue);
+        renderer::RenderSettings render_settings = json_reader::ParseRenderSettings(doc);
+        json_reader::ProcessRequests(doc, catalogue, render_settings, std::cout, GetResponseFormat(text));
+        return 0;
+    }
+
+    const std::string_view mode(argv[1]);
+    if (mode == "serve"sv && (argc == 3 || argc == 4)) {
+        Serve(argv[2], argc == 4 ? argv[3] : nullptr);
+        return 0;
+    }
+    if (argc != 2) {
+        PrintUsage();
+        return 1;
+    }
+
+    if (mode == "make_base"sv) {
+        MakeBase(std::cin);
+    } else if (mode == "process_requests"sv) {
+        ProcessRequests(std::cin, std::cout);
+    } else if (mode == "update_base"sv) {
+        UpdateBase(std::cin, std::cout);
+    } else {
+        PrintUsage();
+        return 1;
+    }
+
     return 0;
 }
@@ -1,9 +1,8 @@
 #include "map_renderer.h"
 #include "transport_catalogue.h"
 #include <algorithm>
-#include <set>
-#include <sstream>
-#include <unordered_set>
+#include <cstdint>
+#include <numeric>
 
 namespace renderer {
 
@@ -12,178 +11,162 @@ RenderSettings GetDefaultRenderSettings() {
     return settings;
 }
 
-std::map<std::string, std::string> AssignRouteColors(
-    const std::vector<domain::Bus*>& buses,
-    const std::vector<std::string>& palette) {
-    
-    std::vector<domain::Bus*> sorted_buses = buses;
-    std::sort(sorted_buses.begin(), sorted_buses.end(), [](const domain::Bus* a, const domain::Bus* b) {
-        return a->name < b->name;
-    });
-    
-    std::map<std::string, std::string> route_colors;
-    size_t color_index = 0;
-    for (const auto* bus : sorted_buses) {
-        if (!bus->stops.empty()) {
-            route_colors[bus->name] = palette[color_index % palette.size()];
-            ++color_index;
-        }
-    }
-    return route_colors;
-}
-
-void RenderRouteLines(const catalogue::TransportCatalogue& catalogue,
-                      const RenderSettings& settings,
-                      svg::Document& doc,
-                      const SphereProjector& projector,
-                      const std::map<std::string, std::string>& route_colors) {
-    const auto& buses = catalogue.GetAllBuses();
-    std::vector<const domain::Bus*> sorted_buses;
-    for (const auto& [name, bus] : buses) {
-        sorted_buses.push_back(bus);
+// Каждая остановка маршрута ищется в каталоге один раз; повторы находятся по
+// номеру имени в плоском массиве, без множеств строк
+RenderPlan BuildRenderPlan(const catalogue::TransportCatalogue& catalogue, const RenderSettings& settings) {
+    std::vector<const domain::Bus*> buses;
+    for (const auto& [name, bus] : catalogue.GetAllBuses()) {
+        if (!bus->stops.empty())
+            buses.push_back(bus);
     }
-    std::sort(sorted_buses.begin(), sorted_buses.end(), [](const domain::Bus* lhs, const domain::Bus* rhs) {
+    std::sort(buses.begin(), buses.end(), [](const domain::Bus* lhs, const domain::Bus* rhs) {
         return lhs->name < rhs->name;
     });
 
-    for (const auto* bus : sorted_buses) {
-        if (bus->stops.size() < 2)
-            continue;
-        std::vector<svg::Point> points;
-        
+    constexpr size_t kUnused = SIZE_MAX;
+    std::vector<size_t> stop_numbers(catalogue.GetNames().GetCount(), kUnused);
+    std::vector<const domain::Stop*> used_stops;
+    RenderPlan plan;
+    plan.routes.reserve(buses.size());
+    for (const auto* bus : buses) {
+        RenderPlan::Route route{bus, {}};
+        route.stops.reserve(bus->stops.size());
         for (const auto& stop_name : bus->stops) {
             const auto* stop = catalogue.GetStop(stop_name);
-            if (stop)
-                points.push_back(projector(stop->coordinates));
-        }
-        if (bus->is_roundtrip) {
-            if (bus->stops.front() != bus->stops.back())
-                points.push_back(points.front());
-        } else {
-            
-            for (size_t i = bus->stops.size() - 1; i > 0; --i) {
-                const auto* stop = catalogue.GetStop(bus->stops[i - 1]);
-                if (stop)
-                    points.push_back(projector(stop->coordinates));
+            if (!stop)
+                continue;
+            size_t& number = stop_numbers[stop->id];
+            if (number == kUnused) {
+                number = used_stops.size();
+                used_stops.push_back(stop);
             }
+            route.stops.push_back(number);
         }
+        plan.routes.push_back(std::move(route));
+    }
+
+    // Остановки — по имени, номера в маршрутах переводятся в этот порядок
+    std::vector<size_t> order(used_stops.size());
+    std::iota(order.begin(), order.end(), size_t{0});
+    std::sort(order.begin(), order.end(), [&used_stops](size_t lhs, size_t rhs) {
+        return used_stops[lhs]->name < used_stops[rhs]->name;
+    });
+    std::vector<size_t> positions(used_stops.size());
+    std::vector<geo::Coordinates> coordinates;
+    coordinates.reserve(used_stops.size());
+    for (size_t position = 0; position < order.size(); ++position) {
+        positions[order[position]] = position;
+        coordinates.push_back(used_stops[order[position]]->coordinates);
+    }
+    for (auto& route : plan.routes) {
+        for (size_t& number : route.stops)
+            number = positions[number];
+    }
+
+    SphereProjector projector(coordinates.begin(), coordinates.end(),
+                              settings.width, settings.height, settings.padding);
+    plan.stops.reserve(order.size());
+    for (size_t position = 0; position < order.size(); ++position) {
+        plan.stops.push_back({used_stops[order[position]]->name, projector(coordinates[position])});
+    }
+    return plan;
+}
+
+namespace {
+
+// Цвета палитры идут по кругу в порядке маршрутов плана
+const svg::Color& GetRouteColor(const RenderSettings& settings, size_t route_index) {
+    return settings.color_palette[route_index % settings.color_palette.size()];
+}
+
+void RenderRouteLines(const RenderPlan& plan,
+                      const RenderSettings& settings,
+                      svg::Document& doc) {
+    for (size_t index = 0; index < plan.routes.size(); ++index) {
+        const auto& route = plan.routes[index];
+        if (route.stops.size() < 2)
+            continue;
         svg::Polyline polyline;
-        for (const auto& pt : points)
-            polyline.AddPoint(pt);
+        for (size_t stop : route.stops)
+            polyline.AddPoint(plan.stops[stop].point);
+        if (route.bus->is_roundtrip) {
+            if (route.stops.front() != route.stops.back())
+                polyline.AddPoint(plan.stops[route.stops.front()].point);
+        } else {
+            for (size_t i = route.stops.size() - 1; i > 0; --i)
+                polyline.AddPoint(plan.stops[route.stops[i - 1]].point);
+        }
         polyline.SetFillColor(svg::NoneColor)
-                .SetStrokeColor(route_colors.at(bus->name))
+                .SetStrokeColor(GetRouteColor(settings, index))
                 .SetStrokeWidth(settings.line_width)
                 .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
                 .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-        doc.AddPtr(std::make_unique<svg::Polyline>(polyline));
+        doc.Add(std::move(polyline));
     }
 }
 
-void RenderRouteLabels(const catalogue::TransportCatalogue& catalogue,
-                         const RenderSettings& settings,
-                         svg::Document& doc,
-                         const SphereProjector& projector,
-                         const std::map<std::string, std::string>& route_colors) {
-    const auto& buses = catalogue.GetAllBuses();
-    std::vector<const domain::Bus*> sorted_buses;
-    for (const auto& [name, bus] : buses) {
-        sorted_buses.push_back(bus);
-    }
-    std::sort(sorted_buses.begin(), sorted_buses.end(), [](const domain::Bus* lhs, const domain::Bus* rhs) {
-        return lhs->name < rhs->name;
-    });
-    
-    for (const auto* bus : sorted_buses) {
-        if (bus->stops.empty())
+void RenderRouteLabels(const RenderPlan& plan,
+                       const RenderSettings& settings,
+                       svg::Document& doc) {
+    for (size_t index = 0; index < plan.routes.size(); ++index) {
+        const auto& route = plan.routes[index];
+        if (route.stops.empty())
             continue;
-        
-        std::vector<svg::Point> endpoints;
-        const auto* first_stop = catalogue.GetStop(bus->stops.front());
-        if (first_stop)
-            endpoints.push_back(projector(first_stop->coordinates));
-        if (!bus->is_roundtrip && bus->stops.front() != bus->stops.back()) {
-            const auto* last_stop = catalogue.GetStop(bus->stops.back());
-            if (last_stop)
-                endpoints.push_back(projector(last_stop->coordinates));
-        }
-        
+
+        std::vector<svg::Point> endpoints{plan.stops[route.stops.front()].point};
+        if (!route.bus->is_roundtrip && route.stops.front() != route.stops.back())
+            endpoints.push_back(plan.stops[route.stops.back()].point);
+
         for (const auto& pt : endpoints) {
-            
             svg::Text underlayer;
             underlayer.SetPosition(pt)
                       .SetOffset({settings.bus_label_offset.first, settings.bus_label_offset.second})
                       .SetFontSize(settings.bus_label_font_size)
                       .SetFontFamily("Verdana")
                       .SetFontWeight("bold")
-                      .SetData(bus->name)
+                      .SetData(std::string(route.bus->name))
                       .SetFillColor(settings.underlayer_color)
                       .SetStrokeColor(settings.underlayer_color)
                       .SetStrokeWidth(settings.underlayer_width)
                       .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
                       .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-            
+
             svg::Text label;
             label.SetPosition(pt)
                  .SetOffset({settings.bus_label_offset.first, settings.bus_label_offset.second})
                  .SetFontSize(settings.bus_label_font_size)
                  .SetFontFamily("Verdana")
                  .SetFontWeight("bold")
-                 .SetData(bus->name)
-                 .SetFillColor(route_colors.at(bus->name));
-            doc.AddPtr(std::make_unique<svg::Text>(underlayer));
-            doc.AddPtr(std::make_unique<svg::Text>(label));
+                 .SetData(std::string(route.bus->name))
+                 .SetFillColor(GetRouteColor(settings, index));
+            doc.Add(std::move(underlayer));
+            doc.Add(std::move(label));
         }
     }
 }
 
-void RenderStopCircles(const catalogue::TransportCatalogue& catalogue,
+void RenderStopCircles(const RenderPlan& plan,
                        const RenderSettings& settings,
-                       svg::Document& doc,
-                       const SphereProjector& projector) {
-    std::unordered_set<std::string> stop_names;
-    const auto& buses = catalogue.GetAllBuses();
-    for (const auto& [bus_name, bus] : buses) {
-        for (const auto& stop : bus->stops)
-            stop_names.insert(stop);
-    }
-    std::vector<std::string> sorted_stops(stop_names.begin(), stop_names.end());
-    std::sort(sorted_stops.begin(), sorted_stops.end());
-    for (const auto& stop_name : sorted_stops) {
-        const auto* stop = catalogue.GetStop(stop_name);
-        if (!stop)
-            continue;
+                       svg::Document& doc) {
+    for (const auto& stop : plan.stops) {
         svg::Circle circle;
-        circle.SetCenter(projector(stop->coordinates))
+        circle.SetCenter(stop.point)
               .SetRadius(settings.stop_radius)
               .SetFillColor("white");
-        doc.AddPtr(std::make_unique<svg::Circle>(circle));
+        doc.Add(std::move(circle));
     }
 }
 
-void RenderStopLabels(const catalogue::TransportCatalogue& catalogue,
+void RenderStopLabels(const RenderPlan& plan,
                       const RenderSettings& settings,
-                      svg::Document& doc,
-                      const SphereProjector& projector) {
-    std::unordered_set<std::string> stop_names;
-    const auto& buses = catalogue.GetAllBuses();
-    for (const auto& [bus_name, bus] : buses) {
-        for (const auto& stop : bus->stops)
-            stop_names.insert(stop);
-    }
-    std::vector<std::string> sorted_stops(stop_names.begin(), stop_names.end());
-    std::sort(sorted_stops.begin(), sorted_stops.end());
-    for (const auto& stop_name : sorted_stops) {
-        const auto* stop = catalogue.GetStop(stop_name);
-        if (!stop)
-            continue;
-        svg::Point pt = projector(stop->coordinates);
-        
+                      svg::Document& doc) {
+    for (const auto& stop : plan.stops) {
         svg::Text underlayer;
-        underlayer.SetPosition(pt)
+        underlayer.SetPosition(stop.point)
                   .SetOffset({settings.stop_label_offset.first, settings.stop_label_offset.second})
                   .SetFontSize(settings.stop_label_font_size)
                   .SetFontFamily("Verdana")
-                  .SetData(stop_name)
+                  .SetData(std::string(stop.name))
                   .SetFillColor(settings.underlayer_color)
                   .SetStrokeColor(settings.underlayer_color)
                   .SetStrokeWidth(settings.underlayer_width)
@@ -191,54 +174,30 @@ void RenderStopLabels(const catalogue::TransportCatalogue& catalogue,
                   .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
 
         svg::Text label;
-        label.SetPosition(pt)
+        label.SetPosition(stop.point)
              .SetOffset({settings.stop_label_offset.first, settings.stop_label_offset.second})
              .SetFontSize(settings.stop_label_font_size)
              .SetFontFamily("Verdana")
-             .SetData(stop_name)
+             .SetData(std::string(stop.name))
              .SetFillColor("black");
-        doc.AddPtr(std::make_unique<svg::Text>(underlayer));
-        doc.AddPtr(std::make_unique<svg::Text>(label));
+        doc.Add(std::move(underlayer));
+        doc.Add(std::move(label));
     }
 }
 
-void RenderMap(const catalogue::TransportCatalogue& catalogue, 
-               const RenderSettings& settings, 
+}  // namespace
+
+void RenderMap(const catalogue::TransportCatalogue& catalogue,
+               const RenderSettings& settings,
                std::ostream& out) {
+    const RenderPlan plan = BuildRenderPlan(catalogue, settings);
+
     svg::Document svg_doc;
+    RenderRouteLines(plan, settings, svg_doc);
+    RenderRouteLabels(plan, settings, svg_doc);
+    RenderStopCircles(plan, settings, svg_doc);
+    RenderStopLabels(plan, settings, svg_doc);
 
-    const auto& bus_map = catalogue.GetAllBuses();
-    std::unordered_set<std::string> all_stop_names;
-    for (const auto& [bus_name, bus] : bus_map) {
-        for (const auto& stop : bus->stops)
-            all_stop_names.insert(stop);
-    }
-    std::vector<geo::Coordinates> geo_coords;
-    for (const auto& stop_name : all_stop_names) {
-        const auto* stop = catalogue.GetStop(stop_name);
-        if (stop)
-            geo_coords.push_back(stop->coordinates);
-    }
-    SphereProjector projector(geo_coords.begin(), geo_coords.end(),
-                              settings.width, settings.height, settings.padding);
-    
-    std::vector<domain::Bus*> domain_buses;
-    std::vector<const domain::Bus*> sorted_buses;
-    for (const auto& [bus_name, bus] : bus_map)
-        sorted_buses.push_back(bus);
-    std::sort(sorted_buses.begin(), sorted_buses.end(), [](const domain::Bus* lhs, const domain::Bus* rhs) {
-        return lhs->name < rhs->name;
-    });
-    for (const auto* bus : sorted_buses)
-        domain_buses.push_back(const_cast<domain::Bus*>(bus));
-    auto route_colors = AssignRouteColors(domain_buses, settings.color_palette);
-    
-
-    RenderRouteLines(catalogue, settings, svg_doc, projector, route_colors);
-    RenderRouteLabels(catalogue, settings, svg_doc, projector, route_colors);
-    RenderStopCircles(catalogue, settings, svg_doc, projector);
-    RenderStopLabels(catalogue, settings, svg_doc, projector);
-    
     svg_doc.Render(out);
 }
 
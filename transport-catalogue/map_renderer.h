@@ -1,7 +1,6 @@
 #pragma once
 #include <algorithm>
 #include <string>
-#include <algorithm>
 #include <vector>
 #include <utility>
 #include <map>
@@ -103,15 +102,29 @@ struct RenderSettings {
 };
 
 RenderSettings GetDefaultRenderSettings();
-    
-std::map<std::string, std::string> AssignRouteColors(
-    const std::vector<domain::Bus*>& buses,
-    const std::vector<std::string>& palette);
-    
-void RenderRouteLines(const catalogue::TransportCatalogue& catalogue,
-                      const RenderSettings& settings,
-                      svg::Document& doc);
 
+// Всё, что нужно слоям карты, собранное за один проход по маршрутам: маршруты
+// и используемые ими остановки по возрастанию имени, точки остановок уже
+// спроецированы. Маршруты без остановок на карту не попадают и в план не входят
+struct RenderPlan {
+    struct StopPoint {
+        std::string_view name;
+        svg::Point point;
+    };
+    struct Route {
+        const domain::Bus* bus;
+        // Номера остановок маршрута в stops, в порядке маршрута
+        std::vector<size_t> stops;
+    };
+
+    std::vector<Route> routes;
+    std::vector<StopPoint> stops;
+};
+
+RenderPlan BuildRenderPlan(const catalogue::TransportCatalogue& catalogue, const RenderSettings& settings);
+
+// Строит документ заново при каждом вызове, общих данных не меняет: карты для
+// разных запросов можно рисовать параллельно
 void RenderMap(const catalogue::TransportCatalogue& catalogue, 
                const RenderSettings& settings, 
                std::ostream& out);
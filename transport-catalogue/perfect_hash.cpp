@@ -0,0 +1,121 @@
+#include "perfect_hash.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+namespace perfect_hash {
+
+namespace {
+
+// Предел перебора пилотов для одной корзины, после него меняется seed
+constexpr uint32_t kMaxPilot = 1u << 20;
+constexpr int kMaxAttempts = 64;
+
+}  // namespace
+
+uint64_t HashString(std::string_view value, uint64_t seed) {
+    // По 8 байт за шаг; порядок байт машинный, как и у остальных записей базы
+    constexpr uint64_t kMultiplier = 0x9e3779b97f4a7c15ull;
+    uint64_t hash = seed ^ (value.size() * kMultiplier);
+    size_t pos = 0;
+    for (; pos + sizeof(uint64_t) <= value.size(); pos += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, value.data() + pos, sizeof(word));
+        hash = (hash ^ word) * kMultiplier;
+        hash ^= hash >> 29;
+    }
+    if (pos < value.size()) {
+        uint64_t word = 0;
+        std::memcpy(&word, value.data() + pos, value.size() - pos);
+        hash = (hash ^ word) * kMultiplier;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+PerfectHash::PerfectHash(uint64_t seed, uint64_t key_count, std::vector<uint32_t> pilots)
+    : seed_(seed)
+    , key_count_(key_count)
+    , pilots_(std::move(pilots)) {
+    if (key_count_ > 0 && pilots_.empty()) {
+        throw std::invalid_argument("Perfect hash without buckets");
+    }
+}
+
+PerfectHash PerfectHash::Build(const std::vector<std::string_view>& keys) {
+    PerfectHash result;
+    if (keys.empty()) {
+        return result;
+    }
+    // С повторным ключом не подойдёт ни одно зерно: лучше сразу сказать, какой ключ повторён
+    std::vector<std::string_view> sorted_keys(keys);
+    std::sort(sorted_keys.begin(), sorted_keys.end());
+    if (const auto it = std::adjacent_find(sorted_keys.begin(), sorted_keys.end()); it != sorted_keys.end()) {
+        throw std::invalid_argument("Duplicate perfect hash key: " + std::string(*it));
+    }
+    for (int attempt = 0; attempt < kMaxAttempts; ++attempt) {
+        result.seed_ = Mix(static_cast<uint64_t>(attempt) + 0x9e3779b97f4a7c15ull);
+        if (result.TryBuild(keys)) {
+            return result;
+        }
+    }
+    throw std::runtime_error("Failed to build perfect hash");
+}
+
+bool PerfectHash::TryBuild(const std::vector<std::string_view>& keys) {
+    key_count_ = keys.size();
+    pilots_.assign((key_count_ + kKeysPerBucket - 1) / kKeysPerBucket, 0);
+
+    std::vector<uint64_t> hashes(keys.size());
+    std::vector<std::vector<uint64_t>> buckets(pilots_.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        hashes[i] = HashString(keys[i], seed_);
+        buckets[GetBucket(hashes[i])].push_back(hashes[i]);
+    }
+
+    // Крупные корзины размещаются первыми, пока свободных слотов много
+    std::vector<size_t> order(buckets.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&buckets](size_t lhs, size_t rhs) {
+        return buckets[lhs].size() > buckets[rhs].size();
+    });
+
+    std::vector<bool> taken(key_count_, false);
+    std::vector<size_t> slots;
+    for (size_t bucket : order) {
+        const auto& bucket_hashes = buckets[bucket];
+        if (bucket_hashes.empty()) {
+            break;
+        }
+        bool placed = false;
+        for (uint32_t pilot = 0; pilot < kMaxPilot && !placed; ++pilot) {
+            slots.clear();
+            placed = true;
+            for (uint64_t hash : bucket_hashes) {
+                const size_t slot = GetSlot(hash, pilot);
+                if (taken[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+                    placed = false;
+                    break;
+                }
+                slots.push_back(slot);
+            }
+            if (placed) {
+                pilots_[bucket] = pilot;
+                for (size_t slot : slots) {
+                    taken[slot] = true;
+                }
+            }
+        }
+        if (!placed) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace perfect_hash
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#if defined(_MSC_VER) && !defined(__SIZEOF_INT128__) && (defined(_M_X64) || defined(_M_ARM64))
+#include <intrin.h>
+#endif
+
+namespace perfect_hash {
+
+// Стабильный 64-битный хэш строки: сохраняется в бинарной базе,
+// поэтому не может зависеть от реализации std::hash
+uint64_t HashString(std::string_view value, uint64_t seed);
+
+// Минимальная совершенная хэш-функция (hash-and-displace): n различных ключей
+// отображаются на слоты 0..n-1 без коллизий. Ключ хэшируется один раз, по
+// хэшу выбирается корзина, а «пилот» корзины перемешивает хэш в номер слота.
+// Для ключа не из множества возвращается произвольный слот, поэтому
+// вызывающий код сверяет найденный ключ.
+class PerfectHash {
+public:
+    PerfectHash() = default;
+    PerfectHash(uint64_t seed, uint64_t key_count, std::vector<uint32_t> pilots);
+
+    static PerfectHash Build(const std::vector<std::string_view>& keys);
+
+    size_t operator()(std::string_view key) const {
+        const uint64_t hash = HashString(key, seed_);
+        return GetSlot(hash, pilots_[GetBucket(hash)]);
+    }
+
+    bool IsEmpty() const {
+        return key_count_ == 0;
+    }
+    uint64_t GetSeed() const {
+        return seed_;
+    }
+    uint64_t GetKeyCount() const {
+        return key_count_;
+    }
+    const std::vector<uint32_t>& GetPilots() const {
+        return pilots_;
+    }
+
+private:
+    // Средний размер корзины; меньше — быстрее построение, больше — компактнее
+    static constexpr uint64_t kKeysPerBucket = 4;
+
+    static uint64_t Mix(uint64_t value) {
+        // Финализатор splitmix64
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+        return value ^ (value >> 31);
+    }
+    // Старшие 64 бита 128-битного произведения. Результат одинаков на всех платформах,
+    // иначе сохранённые в базе пилоты перестали бы подходить
+    static uint64_t MulHigh(uint64_t lhs, uint64_t rhs) {
+#if defined(__SIZEOF_INT128__)
+        // __extension__: тип не из стандарта, -Wpedantic о нём не предупреждает
+        __extension__ typedef unsigned __int128 Wide;
+        return static_cast<uint64_t>((static_cast<Wide>(lhs) * rhs) >> 64);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+        return __umulh(lhs, rhs);
+#else
+        // Умножение по 32-битным половинам
+        const uint64_t lhs_low = lhs & 0xFFFFFFFFull;
+        const uint64_t lhs_high = lhs >> 32;
+        const uint64_t rhs_low = rhs & 0xFFFFFFFFull;
+        const uint64_t rhs_high = rhs >> 32;
+        const uint64_t low_low = lhs_low * rhs_low;
+        const uint64_t high_low = lhs_high * rhs_low;
+        const uint64_t low_high = lhs_low * rhs_high;
+        const uint64_t middle = (low_low >> 32) + (high_low & 0xFFFFFFFFull) + low_high;
+        return lhs_high * rhs_high + (high_low >> 32) + (middle >> 32);
+#endif
+    }
+    size_t GetBucket(uint64_t hash) const {
+        return static_cast<size_t>(((hash >> 32) * pilots_.size()) >> 32);
+    }
+    size_t GetSlot(uint64_t hash, uint32_t pilot) const {
+        // Умножение со сдвигом вместо деления по модулю
+        const uint64_t mixed = Mix(hash ^ (pilot * 0x9e3779b97f4a7c15ull));
+        return static_cast<size_t>(MulHigh(mixed, key_count_));
+    }
+    bool TryBuild(const std::vector<std::string_view>& keys);
+
+    uint64_t seed_ = 0;
+    uint64_t key_count_ = 0;
+    std::vector<uint32_t> pilots_;
+};
+
+}  // namespace perfect_hash
@@ -0,0 +1,43 @@
+#include "prefix_index.h"
+
+#include <algorithm>
+
+namespace prefix_index {
+
+PrefixIndex::PrefixIndex(std::vector<Entry> entries)
+    : entries_(std::move(entries)) {
+    std::sort(entries_.begin(), entries_.end(), [](const Entry& lhs, const Entry& rhs) {
+        return lhs.key < rhs.key;
+    });
+    lcp_.assign(entries_.size(), 0);
+    for (size_t i = 1; i < entries_.size(); ++i) {
+        const auto& prev = entries_[i - 1].key;
+        const auto& cur = entries_[i].key;
+        const size_t max_length = std::min(prev.size(), cur.size());
+        size_t length = 0;
+        while (length < max_length && prev[length] == cur[length]) {
+            ++length;
+        }
+        lcp_[i] = static_cast<uint32_t>(length);
+    }
+}
+
+std::vector<uint32_t> PrefixIndex::FindByPrefix(std::string_view prefix, size_t limit) const {
+    std::vector<uint32_t> result;
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), prefix, [](const Entry& entry, std::string_view key) {
+        return entry.key < key;
+    });
+    if (it == entries_.end() || it->key.substr(0, prefix.size()) != prefix) {
+        return result;
+    }
+    // Следующий ключ тоже начинается с prefix, если делит с предыдущим не меньше prefix.size() символов
+    for (size_t i = it - entries_.begin(); i < entries_.size() && result.size() < limit; ++i) {
+        if (!result.empty() && lcp_[i] < prefix.size()) {
+            break;
+        }
+        result.push_back(entries_[i].value);
+    }
+    return result;
+}
+
+}  // namespace prefix_index
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace prefix_index {
+
+// Отсортированный массив ключей с таблицей LCP (длина общего префикса с
+// предыдущим ключом). Ключи с заданным префиксом идут подряд: начало
+// находится двоичным поиском, а продолжение — по LCP, без сравнения строк.
+// Ключи не копируются, их строки должны жить дольше индекса.
+class PrefixIndex {
+public:
+    struct Entry {
+        std::string_view key;
+        uint32_t value;
+    };
+
+    PrefixIndex() = default;
+    explicit PrefixIndex(std::vector<Entry> entries);
+
+    // Значения первых (в лексикографическом порядке) limit ключей с префиксом prefix
+    std::vector<uint32_t> FindByPrefix(std::string_view prefix, size_t limit) const;
+
+    size_t GetSize() const {
+        return entries_.size();
+    }
+
+private:
+    std::vector<Entry> entries_;
+    std::vector<uint32_t> lcp_;
+};
+
+}  // namespace prefix_index
@@ -1,67 +1,105 @@
 #include "request_handler.h"
-#include "json_builder.h"
+
+#include <ostream>
 
 namespace request_handler {
 
+// Ключи каждого словаря идут по возрастанию: в таком порядке их печатает json::Print
+
 RequestHandler::RequestHandler(const catalogue::TransportCatalogue& catalogue)
     : catalogue_(catalogue) {}
 
-json::Node RequestHandler::GetBusInfo(const std::string& bus_name, int request_id) const {
-    json::Builder builder;
-    
-    if (bus_name.empty()) {
-        return builder.StartDict()
-            .Key("request_id").Value(request_id)
-            .Key("error_message").Value("not found")
-            .EndDict()
-            .Build();
-    }
-
-    const auto* bus = catalogue_.GetBus(bus_name);
-    if (!bus) {
-        return builder.StartDict()
-            .Key("request_id").Value(request_id)
-            .Key("error_message").Value("not found")
-            .EndDict()
-            .Build();
+void RequestHandler::WriteBusInfo(std::string_view bus_name, int request_id, json::Writer& writer) const {
+    if (bus_name.empty() || !catalogue_.GetBus(bus_name)) {
+        WriteError(request_id, "not found", writer);
+        return;
     }
 
     auto stats = catalogue_.GetBusStatistics(bus_name);
     double curvature = (stats.geo_length > 0) ? (stats.length / stats.geo_length) : 0.0;
 
-    return builder.StartDict()
+    writer.StartDict()
+        .Key("curvature").Value(curvature)
         .Key("request_id").Value(request_id)
         .Key("route_length").Value(static_cast<int>(stats.length))
-        .Key("curvature").Value(curvature)
         .Key("stop_count").Value(static_cast<int>(stats.amount))
         .Key("unique_stop_count").Value(static_cast<int>(stats.unique))
-        .EndDict()
-        .Build();
+        .EndDict();
 }
 
-json::Node RequestHandler::GetStopInfo(const std::string& stop_name, int request_id) const {
-    json::Builder builder;
-
+void RequestHandler::WriteStopInfo(std::string_view stop_name, int request_id, json::Writer& writer) const {
     if (stop_name.empty() || !catalogue_.GetStop(stop_name)) {
-        return builder.StartDict()
-            .Key("request_id").Value(request_id)
-            .Key("error_message").Value("not found")
-            .EndDict()
-            .Build();
+        WriteError(request_id, "not found", writer);
+        return;
+    }
+
+    auto buses = writer.StartDict().Key("buses").StartArray();
+    for (NameId bus : catalogue_.GetBusesForStop(stop_name)) {
+        buses.Value(catalogue_.GetNames().GetName(bus));
     }
+    buses.EndArray()
+        .Key("request_id").Value(request_id)
+        .EndDict();
+}
 
-    const auto& buses = catalogue_.GetBusesForStop(stop_name);
+void RequestHandler::WriteSuggestions(std::string_view prefix, size_t count, int request_id,
+                                      json::Writer& writer) const {
+    auto items = writer.StartDict().Key("items").StartArray();
 
-    builder.StartDict()
+    // Имя, общее для остановки и маршрута, даёт два элемента, но всего их не больше
+    // count: первых count имён на это всегда хватает
+    size_t written = 0;
+    for (const auto& [name, stop, bus] : catalogue_.SuggestNames(prefix, count)) {
+        if (stop && written < count) {
+            items.StartDict().Key("name").Value(name).Key("type").Value("Stop").EndDict();
+            ++written;
+        }
+        if (bus && written < count) {
+            items.StartDict().Key("name").Value(name).Key("type").Value("Bus").EndDict();
+            ++written;
+        }
+    }
+
+    items.EndArray()
+        .Key("request_id").Value(request_id)
+        .EndDict();
+}
+
+void RequestHandler::WriteNearbyStops(geo::Coordinates center, size_t count, double radius, int request_id,
+                                      json::Writer& writer) const {
+    auto stops = writer.StartDict()
         .Key("request_id").Value(request_id)
-        .Key("buses").StartArray();
+        .Key("stops").StartArray();
 
-    for (const auto& bus : buses) {
-        builder.Value(std::string(bus));
+    for (const auto& [stop, distance] : catalogue_.GetStopsNearby(center, count, radius)) {
+        stops.StartDict()
+            .Key("distance").Value(distance)
+            .Key("name").Value(stop->name)
+            .EndDict();
     }
 
-    builder.EndArray();
-    return builder.EndDict().Build();
+    stops.EndArray().EndDict();
+}
+
+void WriteError(int request_id, std::string_view message, json::Writer& writer) {
+    writer.StartDict()
+        .Key("error_message").Value(message)
+        .Key("request_id").Value(request_id)
+        .EndDict();
+}
+
+MapCache::MapCache(const catalogue::TransportCatalogue& catalogue, const renderer::RenderSettings& settings)
+    : catalogue_(catalogue)
+    , settings_(settings) {
+}
+
+const json::EscapedString& MapCache::Get() const {
+    std::call_once(rendered_, [this] {
+        map_.emplace([this](std::ostream& output) {
+            renderer::RenderMap(catalogue_, settings_, output);
+        });
+    });
+    return *map_;
 }
 
 }  // namespace request_handler
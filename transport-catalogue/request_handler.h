@@ -1,18 +1,47 @@
 #pragma once
 #include "transport_catalogue.h"
-#include "json.h"
+#include "json_writer.h"
+#include "map_renderer.h"
+
+#include <mutex>
+#include <optional>
 
 namespace request_handler {
 
+// Ответы пишутся сразу в json::Writer очередным значением, без промежуточного дерева
 class RequestHandler {
 public:
     explicit RequestHandler(const catalogue::TransportCatalogue& catalogue);
     
-    json::Node GetBusInfo(const std::string& bus_name, int request_id) const;
-    json::Node GetStopInfo(const std::string& stop_name, int request_id) const;
+    void WriteBusInfo(std::string_view bus_name, int request_id, json::Writer& writer) const;
+    void WriteStopInfo(std::string_view stop_name, int request_id, json::Writer& writer) const;
+    void WriteSuggestions(std::string_view prefix, size_t count, int request_id, json::Writer& writer) const;
+    // count == 0 — без ограничения по количеству, radius в метрах
+    void WriteNearbyStops(geo::Coordinates center, size_t count, double radius, int request_id,
+                          json::Writer& writer) const;
     
 private:
     const catalogue::TransportCatalogue& catalogue_;
 };
 
+// Карта каталога с данными настройками: рисуется при первом Map и дальше отдаётся
+// готовой вместе с видом для JSON, так что ответ на Map — копия байтов. Каталог и
+// настройки после первого Get не должны меняться (так и есть у снимка базы).
+// Get можно вызывать из разных потоков
+class MapCache {
+public:
+    MapCache(const catalogue::TransportCatalogue& catalogue, const renderer::RenderSettings& settings);
+
+    const json::EscapedString& Get() const;
+
+private:
+    const catalogue::TransportCatalogue& catalogue_;
+    const renderer::RenderSettings& settings_;
+    mutable std::once_flag rendered_;
+    mutable std::optional<json::EscapedString> map_;
+};
+
+// {"error_message": ..., "request_id": ...}
+void WriteError(int request_id, std::string_view message, json::Writer& writer);
+
 }  // namespace request_handler
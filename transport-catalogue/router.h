@@ -5,8 +5,11 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <functional>
 #include <iterator>
+#include <limits>
 #include <optional>
+#include <queue>
 #include <stdexcept>
 #include <unordered_map>
 #include <utility>
@@ -20,7 +23,28 @@ private:
     using Graph = DirectedWeightedGraph<Weight>;
 
 public:
+    // Запись матрицы кратчайших путей. Хранится плоским массивом vertex_count x vertex_count
+    // без указателей, поэтому может быть записана в файл и использована прямо из отображения.
+    struct RouteInternalData {
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+        static constexpr EdgeId NO_ROUTE = NO_EDGE - 1;
+
+        Weight weight{};
+        EdgeId prev_edge = NO_ROUTE;
+
+        bool HasRoute() const {
+            return prev_edge != NO_ROUTE;
+        }
+    };
+
+    using EdgesRange = ranges::Range<const Edge<Weight>*>;
+
     explicit Router(const Graph& graph);
+    // Роутер поверх готовых рёбер и матрицы (например, из отображённого в память файла базы).
+    // Данные не копируются и должны жить дольше роутера.
+    Router(EdgesRange edges, size_t vertex_count, const RouteInternalData* routes_internal_data);
+    // Роутер, владеющий уже посчитанной матрицей для графа graph
+    Router(const Graph& graph, std::vector<RouteInternalData> routes_internal_data);
 
     struct RouteInfo {
         Weight weight;
@@ -29,24 +53,169 @@ public:
 
     std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
 
+    // Обновляет матрицу после изменения рёбер графа: весов, концов, новых рёбер и вершин.
+    // Заново (Дейкстрой) считаются только строки, в которых кратчайший путь хотя бы до одной
+    // вершины проходил через изменённое ребро; улучшения через изменённые рёбра затем
+    // распространяются релаксацией за O(V^2) на ребро. Если изменённых рёбер не меньше, чем вершин,
+    // это дороже полного пересчёта за O(V^3), и матрица строится заново. Работает только
+    // с собственной матрицей.
+    void UpdateEdges(const Graph& graph, const std::vector<EdgeId>& changed_edges);
+
+    const RouteInternalData* GetRoutesInternalData() const {
+        return routes_internal_data_;
+    }
+    size_t GetRoutesInternalDataSize() const {
+        return vertex_count_ * vertex_count_;
+    }
+    EdgesRange GetEdges() const {
+        return edges_;
+    }
+    size_t GetVertexCount() const {
+        return vertex_count_;
+    }
+
 private:
-    struct RouteInternalData {
-        Weight weight;
-        std::optional<EdgeId> prev_edge;
-    };
-    using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+    RouteInternalData& At(VertexId vertex_from, VertexId vertex_to) {
+        return owned_routes_internal_data_[vertex_from * vertex_count_ + vertex_to];
+    }
+    const RouteInternalData& At(VertexId vertex_from, VertexId vertex_to) const {
+        return routes_internal_data_[vertex_from * vertex_count_ + vertex_to];
+    }
+
+    const Edge<Weight>& GetEdge(EdgeId edge_id) const {
+        if (edge_id >= static_cast<size_t>(edges_.end() - edges_.begin())
+            || edges_.begin()[edge_id].from >= vertex_count_) {
+            throw std::out_of_range("Edge id is out of range");
+        }
+        return edges_.begin()[edge_id];
+    }
+
+    void Resize(size_t vertex_count) {
+        if (vertex_count < vertex_count_) {
+            throw std::invalid_argument("Vertices cannot be removed from the router");
+        }
+        std::vector<RouteInternalData> resized(vertex_count * vertex_count);
+        for (VertexId vertex_from = 0; vertex_from < vertex_count_; ++vertex_from) {
+            std::copy_n(&At(vertex_from, 0), vertex_count_, &resized[vertex_from * vertex_count]);
+        }
+        for (VertexId vertex = vertex_count_; vertex < vertex_count; ++vertex) {
+            resized[vertex * vertex_count + vertex] = RouteInternalData{ZERO_WEIGHT, RouteInternalData::NO_EDGE};
+        }
+        owned_routes_internal_data_ = std::move(resized);
+        routes_internal_data_ = owned_routes_internal_data_.data();
+        vertex_count_ = vertex_count;
+    }
+
+    // Проходит ли кратчайший путь из vertex_from хотя бы в одну вершину через отмеченное ребро
+    bool RowUsesEdges(VertexId vertex_from, const std::vector<bool>& is_changed,
+                      std::vector<char>& state, std::vector<VertexId>& path) const {
+        enum : char { UNKNOWN, VISITING, USES, CLEAN };
+        std::fill(state.begin(), state.end(), UNKNOWN);
+        for (VertexId vertex_to = 0; vertex_to < vertex_count_; ++vertex_to) {
+            path.clear();
+            char result = CLEAN;
+            for (VertexId vertex = vertex_to;; ) {
+                if (state[vertex] != UNKNOWN) {
+                    // Цикл в цепочке предков — строку надёжнее пересчитать
+                    result = state[vertex] == VISITING ? static_cast<char>(USES) : state[vertex];
+                    break;
+                }
+                const auto& route = At(vertex_from, vertex);
+                if (!route.HasRoute() || route.prev_edge == RouteInternalData::NO_EDGE) {
+                    break;
+                }
+                if (is_changed[route.prev_edge]) {
+                    result = USES;
+                    break;
+                }
+                state[vertex] = VISITING;
+                path.push_back(vertex);
+                vertex = GetEdge(route.prev_edge).from;
+            }
+            if (result == USES) {
+                return true;
+            }
+            for (VertexId vertex : path) {
+                state[vertex] = result;
+            }
+            state[vertex_to] = result;
+        }
+        return false;
+    }
+
+    void RebuildRow(const Graph& graph, VertexId vertex_from) {
+        RouteInternalData* row = &At(vertex_from, 0);
+        std::fill(row, row + vertex_count_, RouteInternalData{});
+        row[vertex_from] = RouteInternalData{ZERO_WEIGHT, RouteInternalData::NO_EDGE};
+
+        using QueueItem = std::pair<Weight, VertexId>;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+        queue.push({ZERO_WEIGHT, vertex_from});
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (row[vertex].weight < weight) {
+                continue;
+            }
+            for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+                const auto& edge = graph.GetEdge(edge_id);
+                if (edge.weight < ZERO_WEIGHT) {
+                    throw std::domain_error("Edges' weights should be non-negative");
+                }
+                if (edge.to == edge.from) {
+                    continue;
+                }
+                const Weight candidate_weight = weight + edge.weight;
+                if (!row[edge.to].HasRoute() || candidate_weight < row[edge.to].weight) {
+                    row[edge.to] = RouteInternalData{candidate_weight, edge_id};
+                    queue.push({candidate_weight, edge.to});
+                }
+            }
+        }
+    }
+
+    void RelaxRoutesInternalDataThroughEdge(EdgeId edge_id) {
+        const auto& edge = GetEdge(edge_id);
+        if (edge.from == edge.to) {
+            return;
+        }
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+        for (VertexId vertex_from = 0; vertex_from < vertex_count_; ++vertex_from) {
+            const auto route_from = At(vertex_from, edge.from);
+            if (!route_from.HasRoute()) {
+                continue;
+            }
+            const RouteInternalData through_edge{route_from.weight + edge.weight, edge_id};
+            for (VertexId vertex_to = 0; vertex_to < vertex_count_; ++vertex_to) {
+                if (const auto& route_to = At(edge.to, vertex_to); route_to.HasRoute()) {
+                    RelaxRoute(vertex_from, vertex_to, through_edge, route_to);
+                }
+            }
+        }
+    }
+
+    // Полный пересчёт матрицы Флойдом — Уоршеллом за O(V^3)
+    void Build(const Graph& graph) {
+        std::fill(owned_routes_internal_data_.begin(), owned_routes_internal_data_.end(), RouteInternalData{});
+        InitializeRoutesInternalData(graph);
+        for (VertexId vertex_through = 0; vertex_through < vertex_count_; ++vertex_through) {
+            RelaxRoutesInternalDataThroughVertex(vertex_count_, vertex_through);
+        }
+    }
 
     void InitializeRoutesInternalData(const Graph& graph) {
         const size_t vertex_count = graph.GetVertexCount();
         for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-            routes_internal_data_[vertex][vertex] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
+            At(vertex, vertex) = RouteInternalData{ZERO_WEIGHT, RouteInternalData::NO_EDGE};
             for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
                 const auto& edge = graph.GetEdge(edge_id);
                 if (edge.weight < ZERO_WEIGHT) {
                     throw std::domain_error("Edges' weights should be non-negative");
                 }
-                auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                if (!route_internal_data || route_internal_data->weight > edge.weight) {
+                auto& route_internal_data = At(vertex, edge.to);
+                if (!route_internal_data.HasRoute() || route_internal_data.weight > edge.weight) {
                     route_internal_data = RouteInternalData{edge.weight, edge_id};
                 }
             }
@@ -55,20 +224,21 @@ private:
 
     void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
                     const RouteInternalData& route_to) {
-        auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
+        auto& route_relaxing = At(vertex_from, vertex_to);
         const Weight candidate_weight = route_from.weight + route_to.weight;
-        if (!route_relaxing || candidate_weight < route_relaxing->weight) {
+        if (!route_relaxing.HasRoute() || candidate_weight < route_relaxing.weight) {
             route_relaxing = {candidate_weight,
-                              route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge};
+                              route_to.prev_edge != RouteInternalData::NO_EDGE ? route_to.prev_edge
+                                                                               : route_from.prev_edge};
         }
     }
 
     void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
         for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-            if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
+            if (const auto route_from = At(vertex_from, vertex_through); route_from.HasRoute()) {
                 for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                    if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                        RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
+                    if (const auto& route_to = At(vertex_through, vertex_to); route_to.HasRoute()) {
+                        RelaxRoute(vertex_from, vertex_to, route_from, route_to);
                     }
                 }
             }
@@ -76,38 +246,93 @@ private:
     }
 
     static constexpr Weight ZERO_WEIGHT{};
-    const Graph& graph_;
-    RoutesInternalData routes_internal_data_;
+    EdgesRange edges_;
+    size_t vertex_count_;
+    std::vector<RouteInternalData> owned_routes_internal_data_;
+    const RouteInternalData* routes_internal_data_;
 };
 
 template <typename Weight>
 Router<Weight>::Router(const Graph& graph)
-    : graph_(graph)
-    , routes_internal_data_(graph.GetVertexCount(),
-                            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+    : edges_(graph.GetEdges())
+    , vertex_count_(graph.GetVertexCount())
+    , owned_routes_internal_data_(vertex_count_ * vertex_count_)
+    , routes_internal_data_(owned_routes_internal_data_.data())
+{
+    Build(graph);
+}
+
+template <typename Weight>
+Router<Weight>::Router(EdgesRange edges, size_t vertex_count, const RouteInternalData* routes_internal_data)
+    : edges_(edges)
+    , vertex_count_(vertex_count)
+    , routes_internal_data_(routes_internal_data)
+{
+}
+
+template <typename Weight>
+Router<Weight>::Router(const Graph& graph, std::vector<RouteInternalData> routes_internal_data)
+    : edges_(graph.GetEdges())
+    , vertex_count_(graph.GetVertexCount())
+    , owned_routes_internal_data_(std::move(routes_internal_data))
+    , routes_internal_data_(owned_routes_internal_data_.data())
 {
-    InitializeRoutesInternalData(graph);
+    if (owned_routes_internal_data_.size() != vertex_count_ * vertex_count_) {
+        throw std::invalid_argument("Routes matrix does not match the graph");
+    }
+}
+
+template <typename Weight>
+void Router<Weight>::UpdateEdges(const Graph& graph, const std::vector<EdgeId>& changed_edges) {
+    if (routes_internal_data_ != owned_routes_internal_data_.data()) {
+        throw std::logic_error("Router over external storage cannot be updated");
+    }
+    edges_ = graph.GetEdges();
+    if (graph.GetVertexCount() != vertex_count_) {
+        Resize(graph.GetVertexCount());
+    }
+    if (changed_edges.size() >= vertex_count_) {
+        Build(graph);
+        return;
+    }
+
+    std::vector<bool> is_changed(graph.GetEdgeCount());
+    for (const EdgeId edge_id : changed_edges) {
+        is_changed.at(edge_id) = true;
+    }
 
-    const size_t vertex_count = graph.GetVertexCount();
-    for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-        RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+    std::vector<char> state(vertex_count_);
+    std::vector<VertexId> path;
+    for (VertexId vertex_from = 0; vertex_from < vertex_count_; ++vertex_from) {
+        if (RowUsesEdges(vertex_from, is_changed, state, path)) {
+            RebuildRow(graph, vertex_from);
+        }
+    }
+    for (const EdgeId edge_id : changed_edges) {
+        RelaxRoutesInternalDataThroughEdge(edge_id);
     }
 }
 
 template <typename Weight>
 std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
                                                                              VertexId to) const {
-    const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-    if (!route_internal_data) {
+    if (from >= vertex_count_ || to >= vertex_count_) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    const auto& route_internal_data = At(from, to);
+    if (!route_internal_data.HasRoute()) {
         return std::nullopt;
     }
-    const Weight weight = route_internal_data->weight;
+    const Weight weight = route_internal_data.weight;
     std::vector<EdgeId> edges;
-    for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-         edge_id;
-         edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+    for (EdgeId edge_id = route_internal_data.prev_edge;
+         edge_id != RouteInternalData::NO_EDGE;
+         edge_id = At(from, GetEdge(edge_id).from).prev_edge)
     {
-        edges.push_back(*edge_id);
+        edges.push_back(edge_id);
+        if (edges.size() > vertex_count_) {
+            throw std::logic_error("Routes matrix contains a cycle");
+        }
     }
     std::reverse(edges.begin(), edges.end());
 
@@ -0,0 +1,410 @@
+#include "serialization.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace serialization {
+
+namespace {
+
+constexpr size_t kAlignment = 8;
+
+size_t SectionIndex(Section section) {
+    return static_cast<size_t>(section);
+}
+
+class BaseWriter {
+public:
+    // Пишет во временный файл и подменяет им базу только в Finish: процессы, уже
+    // отобразившие старую базу, продолжают работать со старым файлом
+    explicit BaseWriter(const std::filesystem::path& path)
+        : path_(path)
+        , temp_path_(path.string() + ".tmp")
+        , out_(temp_path_, std::ios::binary | std::ios::trunc) {
+        if (!out_) {
+            throw std::runtime_error("Cannot open base file for writing: " + path.string());
+        }
+        header_ = Header{};
+        std::memcpy(header_.magic, kMagic, sizeof(kMagic));
+        header_.version = kFormatVersion;
+        header_.section_count = static_cast<uint32_t>(Section::Count);
+        Write(reinterpret_cast<const char*>(&header_), sizeof(header_));
+    }
+
+    StringRef AddString(std::string_view str) {
+        StringRef ref{static_cast<uint32_t>(strings_.size()), static_cast<uint32_t>(str.size())};
+        strings_.append(str);
+        return ref;
+    }
+
+    template <typename Record>
+    void WriteSection(Section section, const Record* records, size_t count) {
+        static_assert(std::is_trivially_copyable_v<Record>);
+        static_assert(alignof(Record) <= kAlignment);
+        auto& ref = header_.sections[SectionIndex(section)];
+        ref.offset = offset_;
+        ref.size = count * sizeof(Record);
+        Write(reinterpret_cast<const char*>(records), ref.size);
+        Pad();
+    }
+
+    template <typename Record>
+    void WriteSection(Section section, const std::vector<Record>& records) {
+        WriteSection(section, records.data(), records.size());
+    }
+
+    void Finish() {
+        WriteSection(Section::Strings, strings_.data(), strings_.size());
+        header_.file_size = offset_;
+        out_.seekp(0);
+        out_.write(reinterpret_cast<const char*>(&header_), sizeof(header_));
+        out_.close();
+        if (!out_) {
+            throw std::runtime_error("Failed to write base file");
+        }
+        std::filesystem::rename(temp_path_, path_);
+    }
+
+private:
+    void Write(const char* data, size_t size) {
+        out_.write(data, static_cast<std::streamsize>(size));
+        offset_ += size;
+    }
+
+    void Pad() {
+        static const char zeros[kAlignment] = {};
+        Write(zeros, (kAlignment - offset_ % kAlignment) % kAlignment);
+    }
+
+    std::filesystem::path path_;
+    std::filesystem::path temp_path_;
+    std::ofstream out_;
+    Header header_;
+    uint64_t offset_ = 0;
+    std::string strings_;
+};
+
+}  // namespace
+
+void SaveBase(const std::filesystem::path& path,
+              const catalogue::TransportCatalogue& catalogue,
+              const renderer::RenderSettings& render_settings,
+              const TransportRouter& router) {
+    BaseWriter writer(path);
+
+    std::unordered_map<std::string_view, uint32_t> stop_index;
+    std::vector<StopRecord> stops;
+    for (const auto& stop : catalogue.GetStops()) {
+        stop_index[stop.name] = static_cast<uint32_t>(stops.size());
+        StopRecord record{writer.AddString(stop.name), stop.coordinates.lat, stop.coordinates.lng,
+                          kNoIndex, kNoIndex};
+        if (auto it = router.GetStopVertices().find(stop.name); it != router.GetStopVertices().end()) {
+            record.wait_vertex = static_cast<uint32_t>(it->second.wait);
+            record.bus_vertex = static_cast<uint32_t>(it->second.bus);
+        }
+        stops.push_back(record);
+    }
+
+    std::unordered_map<std::string_view, uint32_t> bus_index;
+    std::vector<BusRecord> buses;
+    std::vector<uint32_t> bus_stops;
+    for (const auto& bus : catalogue.GetBuses()) {
+        bus_index[bus.name] = static_cast<uint32_t>(buses.size());
+        BusRecord record{writer.AddString(bus.name), static_cast<uint32_t>(bus_stops.size()),
+                         static_cast<uint32_t>(bus.stops.size()), bus.is_roundtrip ? 1u : 0u, 0};
+        for (const auto& stop : bus.stops) {
+            bus_stops.push_back(stop_index.at(stop));
+        }
+        buses.push_back(record);
+    }
+
+    std::vector<DistanceRecord> distances;
+    for (const auto& [stops_pair, distance] : catalogue.GetDistances()) {
+        distances.push_back({stop_index.at(stops_pair.first->name), stop_index.at(stops_pair.second->name),
+                             distance, 0});
+    }
+    // Порядок обхода unordered_map не определён — сортируем, чтобы файл был воспроизводимым
+    std::sort(distances.begin(), distances.end(), [](const DistanceRecord& lhs, const DistanceRecord& rhs) {
+        return std::tie(lhs.from, lhs.to) < std::tie(rhs.from, rhs.to);
+    });
+
+    RenderSettingsRecord render{};
+    render.width = render_settings.width;
+    render.height = render_settings.height;
+    render.padding = render_settings.padding;
+    render.line_width = render_settings.line_width;
+    render.stop_radius = render_settings.stop_radius;
+    render.bus_label_font_size = render_settings.bus_label_font_size;
+    render.stop_label_font_size = render_settings.stop_label_font_size;
+    render.bus_label_offset[0] = render_settings.bus_label_offset.first;
+    render.bus_label_offset[1] = render_settings.bus_label_offset.second;
+    render.stop_label_offset[0] = render_settings.stop_label_offset.first;
+    render.stop_label_offset[1] = render_settings.stop_label_offset.second;
+    render.underlayer_color = writer.AddString(render_settings.underlayer_color);
+    render.underlayer_width = render_settings.underlayer_width;
+
+    std::vector<StringRef> palette;
+    for (const auto& color : render_settings.color_palette) {
+        palette.push_back(writer.AddString(color));
+    }
+
+    const auto& routes = router.GetRouter();
+    RoutingSettingsRecord routing{router.GetSettings().bus_wait_time, 0, router.GetSettings().bus_velocity,
+                                  routes.GetVertexCount()};
+    const auto edges = routes.GetEdges();
+
+    // Рёбра удалённых остановок и маршрутов остаются в графе петлями, их имён уже нет в каталоге
+    auto find_index = [](const std::unordered_map<std::string_view, uint32_t>& index, std::string_view name) {
+        auto it = index.find(name);
+        return it != index.end() ? it->second : kNoIndex;
+    };
+    std::vector<EdgeInfoRecord> edge_info;
+    edge_info.reserve(router.GetEdgeInfo().size());
+    for (const auto& info : router.GetEdgeInfo()) {
+        edge_info.push_back({static_cast<uint32_t>(info.type), find_index(stop_index, info.stop_name),
+                             info.type == EdgeType::Bus ? find_index(bus_index, info.bus) : kNoIndex,
+                             info.span_count, info.time});
+    }
+
+    writer.WriteSection(Section::Stops, stops);
+    writer.WriteSection(Section::Buses, buses);
+    writer.WriteSection(Section::BusStops, bus_stops);
+    writer.WriteSection(Section::Distances, distances);
+    writer.WriteSection(Section::RenderSettings, &render, 1);
+    writer.WriteSection(Section::Palette, palette);
+    writer.WriteSection(Section::RoutingSettings, &routing, 1);
+    writer.WriteSection(Section::Edges, edges.begin(), edges.end() - edges.begin());
+    writer.WriteSection(Section::EdgeInfo, edge_info);
+    writer.WriteSection(Section::Routes, routes.GetRoutesInternalData(), routes.GetRoutesInternalDataSize());
+    // Функция незамороженного каталога пуста, тогда она строится заново при загрузке
+    const auto& name_index = catalogue.GetNameIndex();
+    const NameIndexRecord name_index_record{name_index.GetSeed(), name_index.GetKeyCount()};
+    writer.WriteSection(Section::NameIndex, &name_index_record, 1);
+    writer.WriteSection(Section::NamePilots, name_index.GetPilots());
+    writer.Finish();
+}
+
+MappedBase::MappedBase(const std::filesystem::path& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open base file: " + path.string());
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header))) {
+        ::close(fd);
+        throw BaseFormatError("Base file is too small: " + path.string());
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    // Отображение только для чтения и MAP_SHARED: несколько процессов, открывших одну базу,
+    // разделяют одни и те же страницы page cache
+    void* data = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Cannot map base file: " + path.string());
+    }
+    data_ = static_cast<const char*>(data);
+    try {
+        Validate();
+    } catch (...) {
+        ::munmap(const_cast<char*>(data_), size_);
+        throw;
+    }
+    AdviseRandomAccess(Section::Routes);
+}
+
+size_t MappedBase::GetMappedSize() const {
+    return size_;
+}
+
+void MappedBase::AdviseRandomAccess(Section section) const {
+    // Матрица маршрутов читается точечно: упреждающее чтение только засоряет page cache
+    const auto& ref = reinterpret_cast<const Header*>(data_)->sections[SectionIndex(section)];
+    const uintptr_t page_size = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(data_ + ref.offset) & ~(page_size - 1);
+    const uintptr_t end = reinterpret_cast<uintptr_t>(data_ + ref.offset + ref.size);
+    if (end > begin) {
+        ::madvise(reinterpret_cast<void*>(begin), end - begin, MADV_RANDOM);
+    }
+}
+
+MappedBase::~MappedBase() {
+    ::munmap(const_cast<char*>(data_), size_);
+}
+
+void MappedBase::Validate() const {
+    const auto& header = *reinterpret_cast<const Header*>(data_);
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        throw BaseFormatError("Not a transport catalogue base file");
+    }
+    if (header.version != kFormatVersion) {
+        throw BaseFormatError("Unsupported base file version " + std::to_string(header.version));
+    }
+    if (header.section_count != static_cast<uint32_t>(Section::Count) || header.file_size != size_) {
+        throw BaseFormatError("Corrupted base file header");
+    }
+    for (const auto& section : header.sections) {
+        if (section.offset % kAlignment != 0 || section.offset > size_ || section.size > size_ - section.offset) {
+            throw BaseFormatError("Base file section is out of bounds");
+        }
+    }
+    if (GetSection<RenderSettingsRecord>(Section::RenderSettings).end()
+            - GetSection<RenderSettingsRecord>(Section::RenderSettings).begin() != 1
+        || GetSection<RoutingSettingsRecord>(Section::RoutingSettings).end()
+            - GetSection<RoutingSettingsRecord>(Section::RoutingSettings).begin() != 1) {
+        throw BaseFormatError("Base file has no settings");
+    }
+    const uint64_t vertex_count = GetSection<RoutingSettingsRecord>(Section::RoutingSettings).begin()->vertex_count;
+    const auto routes = GetSection<RouteRecord>(Section::Routes);
+    if (static_cast<uint64_t>(routes.end() - routes.begin()) != vertex_count * vertex_count) {
+        throw BaseFormatError("Base file routes matrix has wrong size");
+    }
+}
+
+template <typename Record>
+ranges::Range<const Record*> MappedBase::GetSection(Section section) const {
+    const auto& ref = reinterpret_cast<const Header*>(data_)->sections[SectionIndex(section)];
+    if (ref.size % sizeof(Record) != 0) {
+        throw BaseFormatError("Base file section has wrong size");
+    }
+    const auto* begin = reinterpret_cast<const Record*>(data_ + ref.offset);
+    return {begin, begin + ref.size / sizeof(Record)};
+}
+
+perfect_hash::PerfectHash MappedBase::GetNameIndex() const {
+    const auto records = GetSection<NameIndexRecord>(Section::NameIndex);
+    const auto pilots = GetSection<uint32_t>(Section::NamePilots);
+    if (records.end() - records.begin() != 1 || records.begin()->key_count == 0 || pilots.empty()) {
+        return {};
+    }
+    return {records.begin()->seed, records.begin()->key_count,
+            std::vector<uint32_t>(pilots.begin(), pilots.end())};
+}
+
+std::string_view MappedBase::GetString(StringRef ref) const {
+    const auto& strings = reinterpret_cast<const Header*>(data_)->sections[SectionIndex(Section::Strings)];
+    if (static_cast<uint64_t>(ref.offset) + ref.size > strings.size) {
+        throw BaseFormatError("Base file string is out of bounds");
+    }
+    return {data_ + strings.offset + ref.offset, ref.size};
+}
+
+void MappedBase::FillCatalogue(catalogue::TransportCatalogue& catalogue) const {
+    const auto stops = GetSection<StopRecord>(Section::Stops);
+    const auto bus_stops = GetSection<uint32_t>(Section::BusStops);
+    const size_t stop_count = stops.end() - stops.begin();
+    const size_t bus_stop_count = bus_stops.end() - bus_stops.begin();
+
+    for (const auto& stop : stops) {
+        catalogue.AddStop(GetString(stop.name), stop.latitude, stop.longitude);
+    }
+    for (const auto& distance : GetSection<DistanceRecord>(Section::Distances)) {
+        if (distance.from >= stop_count || distance.to >= stop_count) {
+            throw BaseFormatError("Base file distance refers to unknown stop");
+        }
+        catalogue.SetDistance(GetString(stops.begin()[distance.from].name),
+                              GetString(stops.begin()[distance.to].name), distance.distance);
+    }
+    std::vector<std::string_view> route;
+    for (const auto& bus : GetSection<BusRecord>(Section::Buses)) {
+        if (static_cast<size_t>(bus.first_stop) + bus.stop_count > bus_stop_count) {
+            throw BaseFormatError("Base file bus refers to unknown stops");
+        }
+        route.clear();
+        for (uint32_t i = 0; i < bus.stop_count; ++i) {
+            const uint32_t index = bus_stops.begin()[bus.first_stop + i];
+            if (index >= stop_count) {
+                throw BaseFormatError("Base file bus refers to unknown stop");
+            }
+            route.push_back(GetString(stops.begin()[index].name));
+        }
+        catalogue.AddBus(GetString(bus.name), route, bus.is_roundtrip != 0);
+    }
+    catalogue.Freeze(GetNameIndex());
+}
+
+renderer::RenderSettings MappedBase::GetRenderSettings() const {
+    const auto& record = *GetSection<RenderSettingsRecord>(Section::RenderSettings).begin();
+    renderer::RenderSettings settings;
+    settings.width = record.width;
+    settings.height = record.height;
+    settings.padding = record.padding;
+    settings.line_width = record.line_width;
+    settings.stop_radius = record.stop_radius;
+    settings.bus_label_font_size = record.bus_label_font_size;
+    settings.stop_label_font_size = record.stop_label_font_size;
+    settings.bus_label_offset = {record.bus_label_offset[0], record.bus_label_offset[1]};
+    settings.stop_label_offset = {record.stop_label_offset[0], record.stop_label_offset[1]};
+    settings.underlayer_color = std::string(GetString(record.underlayer_color));
+    settings.underlayer_width = record.underlayer_width;
+    settings.color_palette.clear();
+    for (const auto& color : GetSection<StringRef>(Section::Palette)) {
+        settings.color_palette.emplace_back(GetString(color));
+    }
+    return settings;
+}
+
+RoutingSettings MappedBase::GetRoutingSettings() const {
+    const auto& record = *GetSection<RoutingSettingsRecord>(Section::RoutingSettings).begin();
+    return {record.bus_wait_time, record.bus_velocity};
+}
+
+std::unique_ptr<TransportRouter> MappedBase::MakeRouter(const catalogue::TransportCatalogue& catalogue) const {
+    const auto& routing = *GetSection<RoutingSettingsRecord>(Section::RoutingSettings).begin();
+    const auto edges = GetSection<EdgeRecord>(Section::Edges);
+
+    // Имена берутся из каталога: описания рёбер и индекс вершин не копируют строки
+    std::vector<std::string_view> stop_names;
+    TransportRouter::StopVertices stop_to_vertex;
+    for (const auto& stop : GetSection<StopRecord>(Section::Stops)) {
+        if (stop.wait_vertex >= routing.vertex_count || stop.bus_vertex >= routing.vertex_count) {
+            throw BaseFormatError("Base file stop vertex is out of range");
+        }
+        const auto* catalogue_stop = catalogue.GetStop(GetString(stop.name));
+        if (!catalogue_stop) {
+            throw BaseFormatError("Base file stop is missing from the catalogue");
+        }
+        stop_names.push_back(catalogue_stop->name);
+        stop_to_vertex[catalogue_stop->name] = {stop.wait_vertex, stop.bus_vertex};
+    }
+    std::vector<std::string_view> bus_names;
+    for (const auto& bus : GetSection<BusRecord>(Section::Buses)) {
+        const auto* catalogue_bus = catalogue.GetBus(GetString(bus.name));
+        if (!catalogue_bus) {
+            throw BaseFormatError("Base file bus is missing from the catalogue");
+        }
+        bus_names.push_back(catalogue_bus->name);
+    }
+
+    std::vector<RouteEdgeInfo> edge_info;
+    edge_info.reserve(edges.end() - edges.begin());
+    for (const auto& info : GetSection<EdgeInfoRecord>(Section::EdgeInfo)) {
+        const bool is_bus = info.type == static_cast<uint32_t>(EdgeType::Bus);
+        if ((info.stop != kNoIndex && info.stop >= stop_names.size())
+            || (info.bus != kNoIndex && info.bus >= bus_names.size())) {
+            throw BaseFormatError("Base file edge info is out of range");
+        }
+        edge_info.push_back({is_bus ? EdgeType::Bus : EdgeType::Wait,
+                             info.stop != kNoIndex ? stop_names[info.stop] : std::string_view{}, info.time,
+                             info.bus != kNoIndex ? bus_names[info.bus] : std::string_view{}, info.span_count});
+    }
+    if (edge_info.size() != static_cast<size_t>(edges.end() - edges.begin())) {
+        throw BaseFormatError("Base file edge info does not match edges");
+    }
+
+    return std::make_unique<TransportRouter>(catalogue, GetRoutingSettings(), edges, routing.vertex_count,
+                                             std::move(stop_to_vertex), std::move(edge_info),
+                                             GetSection<RouteRecord>(Section::Routes).begin());
+}
+
+}  // namespace serialization
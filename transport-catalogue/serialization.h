@@ -0,0 +1,164 @@
+#pragma once
+
+#include "map_renderer.h"
+#include "perfect_hash.h"
+#include "ranges.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+
+namespace serialization {
+
+// Бинарная база: заголовок и набор секций, адресуемых смещениями от начала файла.
+// Все записи — POD-структуры фиксированного размера, выровненные на 8 байт,
+// поэтому файл читается напрямую из отображения в память, без разбора.
+inline constexpr char kMagic[8] = {'T', 'C', 'B', 'A', 'S', 'E', '\0', '\0'};
+inline constexpr uint32_t kFormatVersion = 2;
+inline constexpr uint32_t kNoIndex = UINT32_MAX;
+
+enum class Section : uint32_t {
+    Strings,
+    Stops,
+    Buses,
+    BusStops,
+    Distances,
+    RenderSettings,
+    Palette,
+    RoutingSettings,
+    Edges,
+    EdgeInfo,
+    Routes,
+    NameIndex,
+    NamePilots,
+    Count
+};
+
+struct SectionRef {
+    uint64_t offset = 0;
+    uint64_t size = 0;
+};
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t section_count;
+    uint64_t file_size;
+    SectionRef sections[static_cast<size_t>(Section::Count)];
+};
+
+struct StringRef {
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct StopRecord {
+    StringRef name;
+    double latitude;
+    double longitude;
+    uint32_t wait_vertex;
+    uint32_t bus_vertex;
+};
+
+struct BusRecord {
+    StringRef name;
+    uint32_t first_stop;
+    uint32_t stop_count;
+    uint32_t is_roundtrip;
+    uint32_t reserved;
+};
+
+struct DistanceRecord {
+    uint32_t from;
+    uint32_t to;
+    int32_t distance;
+    uint32_t reserved;
+};
+
+struct RenderSettingsRecord {
+    double width;
+    double height;
+    double padding;
+    double line_width;
+    double stop_radius;
+    int32_t bus_label_font_size;
+    int32_t stop_label_font_size;
+    double bus_label_offset[2];
+    double stop_label_offset[2];
+    StringRef underlayer_color;
+    double underlayer_width;
+};
+
+struct RoutingSettingsRecord {
+    int32_t bus_wait_time;
+    uint32_t reserved;
+    double bus_velocity;
+    uint64_t vertex_count;
+};
+
+struct EdgeInfoRecord {
+    uint32_t type;
+    uint32_t stop;
+    uint32_t bus;
+    int32_t span_count;
+    double time;
+};
+
+// Совершенная хэш-функция имён каталога; пилоты лежат в секции NamePilots
+struct NameIndexRecord {
+    uint64_t seed;
+    uint64_t key_count;
+};
+
+using EdgeRecord = graph::Edge<double>;
+using RouteRecord = graph::Router<double>::RouteInternalData;
+
+class BaseFormatError : public std::runtime_error {
+public:
+    using runtime_error::runtime_error;
+};
+
+// Сохраняет каталог, настройки и построенный роутер в файл
+void SaveBase(const std::filesystem::path& path,
+              const catalogue::TransportCatalogue& catalogue,
+              const renderer::RenderSettings& render_settings,
+              const TransportRouter& router);
+
+// Файл базы, отображённый в память только для чтения (MAP_SHARED).
+// Формат не содержит указателей, только смещения, поэтому одно и то же
+// отображение может разделяться несколькими процессами. Рёбра и матрица
+// маршрутов используются прямо из отображения, поэтому объект должен жить
+// дольше созданного им роутера.
+class MappedBase {
+public:
+    explicit MappedBase(const std::filesystem::path& path);
+    MappedBase(const MappedBase&) = delete;
+    MappedBase& operator=(const MappedBase&) = delete;
+    ~MappedBase();
+
+    // Каталог строится заново по секциям остановок, расстояний и маршрутов
+    // (AddStop, SetDistance, AddBus, Freeze) — это линейный проход, но с копией.
+    // Без копии и пересчёта из отображения берутся только рёбра и матрица маршрутов
+    void FillCatalogue(catalogue::TransportCatalogue& catalogue) const;
+    renderer::RenderSettings GetRenderSettings() const;
+    RoutingSettings GetRoutingSettings() const;
+    std::unique_ptr<TransportRouter> MakeRouter(const catalogue::TransportCatalogue& catalogue) const;
+    size_t GetMappedSize() const;
+
+private:
+    void AdviseRandomAccess(Section section) const;
+    template <typename Record>
+    ranges::Range<const Record*> GetSection(Section section) const;
+    std::string_view GetString(StringRef ref) const;
+    perfect_hash::PerfectHash GetNameIndex() const;
+    void Validate() const;
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+}  // namespace serialization
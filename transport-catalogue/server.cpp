@@ -0,0 +1,323 @@
+#include "server.h"
+
+#include "json_reader.h"
+#include "json_writer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace server {
+
+namespace {
+
+using namespace std::literals;
+using Clock = std::chrono::steady_clock;
+
+// Самая длинная строка запроса от клиента сокета: недописанная строка копится
+// в памяти потока клиента, и без предела клиент мог бы занять её сколько угодно
+constexpr size_t kMaxLineSize = 4 << 20;
+
+// Значения меньше 2^kSubBits хранятся точно, дальше — по 2^kSubBits корзин на степень двойки
+constexpr int kSubBits = 5;
+constexpr uint64_t kSubBuckets = uint64_t{1} << kSubBits;
+
+// Тип запроса для статистики: строки, из которых не удалось достать тип, считаются вместе
+std::string_view GetRequestType(const json::Node& request) {
+    if (request.IsDict()) {
+        const auto& dict = request.AsDict();
+        if (const auto it = dict.find(json::keys::kType); it != dict.end() && it->second.IsString()) {
+            return it->second.AsString();
+        }
+    }
+    return "invalid"sv;
+}
+
+void WriteError(std::string_view message, json::Writer& writer) {
+    writer.StartDict().Key("error_message").Value(message).EndDict();
+}
+
+void SendAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const ssize_t sent = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "send");
+        }
+        data.remove_prefix(static_cast<size_t>(sent));
+    }
+}
+
+}  // namespace
+
+void LatencyHistogram::Add(std::chrono::nanoseconds latency) {
+    const size_t bucket = GetBucket(static_cast<uint64_t>(std::max<int64_t>(latency.count(), 0)));
+    if (bucket >= buckets_.size()) {
+        buckets_.resize(bucket + 1);
+    }
+    ++buckets_[bucket];
+    ++count_;
+}
+
+std::chrono::nanoseconds LatencyHistogram::GetQuantile(double q) const {
+    if (count_ == 0) {
+        return {};
+    }
+    const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(count_))));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < buckets_.size(); ++bucket) {
+        seen += buckets_[bucket];
+        if (seen >= rank) {
+            return std::chrono::nanoseconds(GetBucketStart(bucket));
+        }
+    }
+    return std::chrono::nanoseconds(GetBucketStart(buckets_.size() - 1));
+}
+
+size_t LatencyHistogram::GetBucket(uint64_t value) {
+    if (value < kSubBuckets) {
+        return static_cast<size_t>(value);
+    }
+    int exponent = 0;
+    while ((value >> exponent) >= 2 * kSubBuckets) {
+        ++exponent;
+    }
+    // value >> exponent лежит в [kSubBuckets, 2 * kSubBuckets)
+    return static_cast<size_t>((exponent + 1) * kSubBuckets + ((value >> exponent) - kSubBuckets));
+}
+
+uint64_t LatencyHistogram::GetBucketStart(size_t bucket) {
+    if (bucket < kSubBuckets) {
+        return bucket;
+    }
+    const uint64_t exponent = bucket / kSubBuckets - 1;
+    return (kSubBuckets + bucket % kSubBuckets) << exponent;
+}
+
+void LatencyStats::Record(std::string_view type, std::chrono::nanoseconds latency) {
+    std::lock_guard guard(mutex_);
+    auto it = by_type_.find(type);
+    if (it == by_type_.end()) {
+        it = by_type_.emplace(std::string(type), LatencyHistogram{}).first;
+    }
+    it->second.Add(latency);
+}
+
+json::Node LatencyStats::ToJson() const {
+    auto to_us = [](std::chrono::nanoseconds value) {
+        return static_cast<double>(value.count()) / 1000.0;
+    };
+    std::lock_guard guard(mutex_);
+    json::Dict result;
+    for (const auto& [type, histogram] : by_type_) {
+        result.emplace(type, json::Dict{
+            {"count", static_cast<double>(histogram.GetCount())},
+            {"p50_us", to_us(histogram.GetQuantile(0.5))},
+            {"p99_us", to_us(histogram.GetQuantile(0.99))},
+        });
+    }
+    return result;
+}
+
+void LatencyStats::Report(std::ostream& output) const {
+    const json::Node stats = ToJson();
+    for (const auto& [type, values] : stats.AsDict()) {
+        const auto& dict = values.AsDict();
+        output << std::string_view(type) << ": count "sv << dict.at("count").AsDouble()
+               << ", p50 "sv << dict.at("p50_us").AsDouble() << " us"sv
+               << ", p99 "sv << dict.at("p99_us").AsDouble() << " us\n"sv;
+    }
+}
+
+Server::Server(const snapshot::SnapshotHolder& holder)
+    : holder_(holder) {
+}
+
+void Server::HandleLine(std::string_view line, std::string& output) {
+    if (line.find_first_not_of(" \t\r"sv) == std::string_view::npos) {
+        return;
+    }
+
+    const auto start = Clock::now();
+    const size_t response_start = output.size();
+    // Копия: запрос не переживает блок try. Имена типов короткие и в куче не размещаются
+    std::string type = "invalid";
+    try {
+        const auto request = json::Load(line);
+        const json::Node& root = request.GetRoot();
+        type = GetRequestType(root);
+
+        json::Writer writer(output, json::Format::kCompact);
+        if (type == "Stats" && root.AsDict().count(json::keys::kId)) {
+            writer.StartDict()
+                  .Key("latency").Value(stats_.ToJson())
+                  .Key("request_id").Value(root.AsDict().at(json::keys::kId).AsInt())
+                  .EndDict();
+        } else {
+            const auto current = holder_.Acquire();
+            if (!json_reader::ProcessRequest(root, current->catalogue, current->map,
+                                             *current->router, writer)) {
+                WriteError("invalid request"sv, writer);
+            }
+        }
+    } catch (const std::exception& e) {
+        // Недописанный ответ заменяется сообщением об ошибке
+        output.resize(response_start);
+        json::Writer writer(output, json::Format::kCompact);
+        WriteError(e.what(), writer);
+    }
+
+    output += '\n';
+    stats_.Record(type, Clock::now() - start);
+}
+
+void Server::ServeStream(std::istream& input, std::ostream& output) {
+    std::string response;
+    for (std::string line; std::getline(input, line);) {
+        HandleLine(line, response);
+        output << response;
+        response.clear();
+        // Следующей строки ещё нет: готовый ответ не должен ждать её в буфере
+        if (input.rdbuf()->in_avail() <= 0) {
+            output.flush();
+        }
+    }
+    output.flush();
+}
+
+void Server::ServeSocket(const std::filesystem::path& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    const std::string& native = path.native();
+    if (native.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("Socket path is too long: " + native);
+    }
+    std::copy(native.begin(), native.end(), address.sun_path);
+
+    // Сокет, оставшийся от прошлого запуска, мешает bind; другие файлы не трогаем
+    if (struct stat st {}; ::stat(native.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+        ::unlink(native.c_str());
+    }
+
+    const int listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0) {
+        throw std::system_error(errno, std::generic_category(), "socket");
+    }
+    if (::bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+        || ::listen(listener, SOMAXCONN) != 0) {
+        const int error = errno;
+        ::close(listener);
+        throw std::system_error(error, std::generic_category(), "bind " + native);
+    }
+    listener_ = listener;
+    if (stopping_) {
+        ::shutdown(listener, SHUT_RDWR);
+    }
+
+    int accept_error = 0;
+    while (!stopping_) {
+        const int client = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            accept_error = errno;
+            break;
+        }
+        {
+            std::lock_guard guard(clients_mutex_);
+            clients_.push_back(client);
+            ++active_clients_;
+        }
+        // Поток клиента завершается сам, когда клиент отключается
+        std::thread([this, client] {
+            ServeClient(client);
+        }).detach();
+    }
+
+    // Клиенты, которые ещё подключены, получают конец потока; ждём, пока их потоки выйдут
+    {
+        std::unique_lock lock(clients_mutex_);
+        for (int client : clients_) {
+            ::shutdown(client, SHUT_RDWR);
+        }
+        clients_done_.wait(lock, [this] {
+            return active_clients_ == 0;
+        });
+    }
+    listener_ = -1;
+    ::close(listener);
+    ::unlink(native.c_str());
+    if (accept_error != 0 && !stopping_) {
+        throw std::system_error(accept_error, std::generic_category(), "accept");
+    }
+}
+
+void Server::Stop() {
+    stopping_ = true;
+    if (const int listener = listener_; listener >= 0) {
+        ::shutdown(listener, SHUT_RDWR);
+    }
+}
+
+void Server::ServeClient(int fd) {
+    std::string input;
+    std::string output;
+    char buffer[64 * 1024];
+    try {
+        while (true) {
+            const ssize_t received = ::recv(fd, buffer, sizeof(buffer), 0);
+            if (received < 0 && errno == EINTR) {
+                continue;
+            }
+            if (received <= 0) {
+                break;
+            }
+            input.append(buffer, static_cast<size_t>(received));
+
+            // Все полные строки отвечаются по очереди, а ответы на них уходят одной записью
+            size_t begin = 0;
+            for (size_t end; (end = input.find('\n', begin)) != std::string::npos; begin = end + 1) {
+                HandleLine(std::string_view(input).substr(begin, end - begin), output);
+            }
+            input.erase(0, begin);
+            if (input.size() > kMaxLineSize) {
+                json::Writer writer(output, json::Format::kCompact);
+                WriteError("request line is too long"sv, writer);
+                output += '\n';
+                SendAll(fd, output);
+                break;
+            }
+            if (!output.empty()) {
+                SendAll(fd, output);
+                output.clear();
+            }
+        }
+    } catch (const std::exception& e) {
+        // Клиент отключился посреди ответа — это его дело, сервер продолжает работу
+        std::cerr << "Client error: " << e.what() << std::endl;
+    }
+
+    // Дескриптор убирается из списка до закрытия, чтобы Stop не задел чужой сокет с тем же номером
+    {
+        std::lock_guard guard(clients_mutex_);
+        clients_.erase(std::find(clients_.begin(), clients_.end(), fd));
+    }
+    ::close(fd);
+    // Уведомление под блокировкой: после неё поток уже не обращается к серверу
+    std::lock_guard guard(clients_mutex_);
+    --active_clients_;
+    clients_done_.notify_all();
+}
+
+}  // namespace server
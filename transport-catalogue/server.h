@@ -0,0 +1,95 @@
+#pragma once
+
+#include "json.h"
+#include "snapshot.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace server {
+
+// Гистограмма задержек с логарифмическими корзинами: память не растёт с числом
+// запросов, а квантиль отличается от точного не больше чем на 1/32
+class LatencyHistogram {
+public:
+    void Add(std::chrono::nanoseconds latency);
+
+    uint64_t GetCount() const {
+        return count_;
+    }
+    // Нижняя граница корзины, в которую попадает квантиль q
+    std::chrono::nanoseconds GetQuantile(double q) const;
+
+private:
+    static size_t GetBucket(uint64_t value);
+    static uint64_t GetBucketStart(size_t bucket);
+
+    std::vector<uint64_t> buckets_;
+    uint64_t count_ = 0;
+};
+
+// Задержки по типам запросов; пополняется из потоков всех клиентов
+class LatencyStats {
+public:
+    void Record(std::string_view type, std::chrono::nanoseconds latency);
+    // {"<тип>": {"count": ..., "p50_us": ..., "p99_us": ...}, ...}
+    json::Node ToJson() const;
+    void Report(std::ostream& output) const;
+
+private:
+    mutable std::mutex mutex_;
+    std::map<std::string, LatencyHistogram, std::less<>> by_type_;
+};
+
+// Сервер JSON Lines: строка запроса — один stat_request, ответ — тоже одна строка.
+// Каждый запрос отвечается по текущему снимку базы, так что подмена базы
+// загрузчиком видна без перезапуска. Запрос {"id": ..., "type": "Stats"} возвращает
+// p50/p99 задержки по типам запросов.
+class Server {
+public:
+    explicit Server(const snapshot::SnapshotHolder& holder);
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    // Дописывает в output ответ на одну строку; пустые строки пропускаются
+    void HandleLine(std::string_view line, std::string& output);
+
+    // Читает запросы из input до конца потока; ответ выводится, как только готов
+    void ServeStream(std::istream& input, std::ostream& output);
+
+    // Принимает клиентов на Unix-сокете, по потоку на клиента, пока не вызван Stop.
+    // Перед возвратом отключает оставшихся клиентов и дожидается их потоков.
+    // Клиент, приславший строку длиннее 4 МБ, получает ошибку и отключается
+    void ServeSocket(const std::filesystem::path& path);
+    // Можно вызывать из другого потока: закрывает сокет и отключает клиентов
+    void Stop();
+
+    const LatencyStats& GetStats() const {
+        return stats_;
+    }
+
+private:
+    void ServeClient(int fd);
+
+    const snapshot::SnapshotHolder& holder_;
+    LatencyStats stats_;
+
+    std::atomic<bool> stopping_ = false;
+    std::atomic<int> listener_ = -1;
+    std::mutex clients_mutex_;
+    std::condition_variable clients_done_;
+    std::vector<int> clients_;
+    size_t active_clients_ = 0;
+};
+
+}  // namespace server
@@ -0,0 +1,172 @@
+#include "snapshot.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+#include <sys/stat.h>
+
+namespace snapshot {
+
+std::unique_ptr<Snapshot> LoadSnapshot(const std::filesystem::path& path) {
+    auto result = std::make_unique<Snapshot>();
+    result->base = std::make_unique<serialization::MappedBase>(path);
+    result->base->FillCatalogue(result->catalogue);
+    result->render_settings = result->base->GetRenderSettings();
+    result->router = result->base->MakeRouter(result->catalogue);
+    return result;
+}
+
+SnapshotHolder::Reader::Reader(Reader&& other) noexcept
+    : slot_(other.slot_), snapshot_(other.snapshot_) {
+    other.slot_ = nullptr;
+    other.snapshot_ = nullptr;
+}
+
+SnapshotHolder::Reader::~Reader() {
+    if (slot_) {
+        slot_->store(nullptr, std::memory_order_release);
+    }
+}
+
+SnapshotHolder::HazardBlock::HazardBlock(size_t size)
+    : slots(size) {
+    for (auto& slot : slots) {
+        slot.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+SnapshotHolder::SnapshotHolder(size_t block_size)
+    : block_size_(std::max<size_t>(block_size, 1)) {
+    hazards_.store(new HazardBlock(block_size_), std::memory_order_relaxed);
+}
+
+SnapshotHolder::~SnapshotHolder() {
+    delete current_.load();
+    for (HazardBlock* block = hazards_.load(); block;) {
+        delete std::exchange(block, block->next);
+    }
+}
+
+SnapshotHolder::Reader SnapshotHolder::Acquire() const {
+    while (true) {
+        const Snapshot* snapshot = current_.load(std::memory_order_acquire);
+        if (!snapshot) {
+            return Reader(nullptr, nullptr);
+        }
+        auto& hazard = ClaimSlot(snapshot);
+        // Снимок могли подменить между чтением указателя и занятием слота
+        if (current_.load(std::memory_order_seq_cst) == snapshot) {
+            return Reader(&hazard, snapshot);
+        }
+        hazard.store(nullptr, std::memory_order_release);
+    }
+}
+
+// Новый блок добавляется в начало списка уже с занятым первым слотом. Publish
+// читает голову списка после подмены снимка, поэтому видит и такой слот
+std::atomic<const Snapshot*>& SnapshotHolder::ClaimSlot(const Snapshot* snapshot) const {
+    for (HazardBlock* block = hazards_.load(std::memory_order_acquire); block; block = block->next) {
+        for (auto& hazard : block->slots) {
+            const Snapshot* expected = nullptr;
+            if (hazard.compare_exchange_strong(expected, snapshot, std::memory_order_seq_cst)) {
+                return hazard;
+            }
+        }
+    }
+    auto* block = new HazardBlock(block_size_);
+    block->slots.front().store(snapshot, std::memory_order_relaxed);
+    block->next = hazards_.load(std::memory_order_relaxed);
+    while (!hazards_.compare_exchange_weak(block->next, block, std::memory_order_seq_cst)) {
+    }
+    return block->slots.front();
+}
+
+void SnapshotHolder::Publish(std::unique_ptr<const Snapshot> next) {
+    std::lock_guard guard(publish_mutex_);
+    const Snapshot* previous = current_.exchange(next.release(), std::memory_order_seq_cst);
+    if (!previous) {
+        return;
+    }
+    for (const HazardBlock* block = hazards_.load(std::memory_order_seq_cst); block; block = block->next) {
+        for (const auto& hazard : block->slots) {
+            while (hazard.load(std::memory_order_seq_cst) == previous) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    delete previous;
+}
+
+SnapshotLoader::SnapshotLoader(SnapshotHolder& holder, std::filesystem::path path,
+                               std::chrono::milliseconds poll_interval)
+    : holder_(holder)
+    , path_(std::move(path))
+    , poll_interval_(poll_interval) {
+    LoadAndPublish();
+    thread_ = std::thread([this] {
+        Run();
+    });
+}
+
+SnapshotLoader::~SnapshotLoader() {
+    {
+        std::lock_guard guard(mutex_);
+        stop_ = true;
+    }
+    wakeup_.notify_one();
+    thread_.join();
+}
+
+void SnapshotLoader::Reload() {
+    {
+        std::lock_guard guard(mutex_);
+        reload_requested_ = true;
+    }
+    wakeup_.notify_one();
+}
+
+SnapshotLoader::FileStamp SnapshotLoader::GetStamp(const std::filesystem::path& path) {
+    struct stat st {};
+    if (::stat(path.c_str(), &st) != 0) {
+        return {};
+    }
+    return {static_cast<unsigned long long>(st.st_ino),
+            static_cast<long long>(st.st_mtim.tv_sec) * 1'000'000'000LL + st.st_mtim.tv_nsec};
+}
+
+void SnapshotLoader::LoadAndPublish() {
+    const FileStamp stamp = GetStamp(path_);
+    holder_.Publish(LoadSnapshot(path_));
+    stamp_ = stamp;
+}
+
+void SnapshotLoader::Run() {
+    std::unique_lock lock(mutex_);
+    while (!stop_) {
+        wakeup_.wait_for(lock, poll_interval_, [this] {
+            return stop_ || reload_requested_;
+        });
+        if (stop_) {
+            break;
+        }
+        const bool forced = reload_requested_;
+        reload_requested_ = false;
+        const FileStamp stamp = GetStamp(path_);
+        if (!forced && (stamp == stamp_ || stamp == FileStamp{})) {
+            continue;
+        }
+        lock.unlock();
+        try {
+            LoadAndPublish();
+        } catch (const std::exception& e) {
+            // Битая или недописанная база: продолжаем отвечать по текущему снимку
+            std::cerr << "Failed to reload base: " << e.what() << std::endl;
+            stamp_ = stamp;
+        }
+        lock.lock();
+    }
+}
+
+}  // namespace snapshot
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "map_renderer.h"
+#include "request_handler.h"
+#include "serialization.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace snapshot {
+
+// Всё, что нужно для ответов на запросы. После публикации не изменяется,
+// поэтому читается из любого числа потоков без синхронизации.
+struct Snapshot {
+    std::unique_ptr<serialization::MappedBase> base;
+    catalogue::TransportCatalogue catalogue;
+    renderer::RenderSettings render_settings;
+    std::unique_ptr<TransportRouter> router;
+    // Карта рисуется при первом Map и живёт, пока жив снимок
+    request_handler::MapCache map{catalogue, render_settings};
+};
+
+std::unique_ptr<Snapshot> LoadSnapshot(const std::filesystem::path& path);
+
+// Текущий снимок с RCU-подобной заменой. Читатели не берут блокировок: снимок
+// закрепляется через hazard-слот (один CAS и одна проверка). Publish атомарно
+// подменяет указатель и освобождает старый снимок, только когда его больше
+// не держит ни один читатель, — запросы в работе дорабатывают со старым снимком.
+// Слоты лежат блоками в списке; если все заняты, читатель добавляет новый блок,
+// а не ждёт. Блоки живут до конца SnapshotHolder
+class SnapshotHolder {
+public:
+    class Reader {
+    public:
+        Reader(Reader&& other) noexcept;
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+        Reader& operator=(Reader&&) = delete;
+        ~Reader();
+
+        const Snapshot& operator*() const {
+            return *snapshot_;
+        }
+        const Snapshot* operator->() const {
+            return snapshot_;
+        }
+        explicit operator bool() const {
+            return snapshot_ != nullptr;
+        }
+
+    private:
+        friend class SnapshotHolder;
+        Reader(std::atomic<const Snapshot*>* slot, const Snapshot* snapshot)
+            : slot_(slot), snapshot_(snapshot) {
+        }
+
+        std::atomic<const Snapshot*>* slot_;
+        const Snapshot* snapshot_;
+    };
+
+    // block_size — сколько слотов добавляется, когда свободных не осталось
+    explicit SnapshotHolder(size_t block_size = 64);
+    SnapshotHolder(const SnapshotHolder&) = delete;
+    SnapshotHolder& operator=(const SnapshotHolder&) = delete;
+    ~SnapshotHolder();
+
+    // Пустой Reader, если снимок ещё не опубликован
+    Reader Acquire() const;
+    // Вызывается загрузчиком; ждёт завершения читателей предыдущего снимка
+    void Publish(std::unique_ptr<const Snapshot> next);
+
+private:
+    struct HazardBlock {
+        explicit HazardBlock(size_t size);
+
+        std::vector<std::atomic<const Snapshot*>> slots;
+        // Следующий блок не меняется после того, как блок добавлен в список
+        HazardBlock* next = nullptr;
+    };
+
+    // Занимает свободный слот под snapshot, при нехватке — в новом блоке
+    std::atomic<const Snapshot*>& ClaimSlot(const Snapshot* snapshot) const;
+
+    std::atomic<const Snapshot*> current_{nullptr};
+    const size_t block_size_;
+    mutable std::atomic<HazardBlock*> hazards_{nullptr};
+    std::mutex publish_mutex_;
+};
+
+// Фоновый загрузчик: следит за файлом базы и, когда файл подменяют
+// (update_base пишет новую базу и переименовывает её), строит новый
+// снимок в своём потоке и публикует его.
+class SnapshotLoader {
+public:
+    SnapshotLoader(SnapshotHolder& holder, std::filesystem::path path,
+                   std::chrono::milliseconds poll_interval = std::chrono::milliseconds(500));
+    SnapshotLoader(const SnapshotLoader&) = delete;
+    SnapshotLoader& operator=(const SnapshotLoader&) = delete;
+    ~SnapshotLoader();
+
+    // Просит перечитать базу, не дожидаясь изменения файла
+    void Reload();
+
+private:
+    struct FileStamp {
+        unsigned long long inode = 0;
+        long long mtime_ns = 0;
+        bool operator==(const FileStamp& other) const {
+            return inode == other.inode && mtime_ns == other.mtime_ns;
+        }
+    };
+
+    static FileStamp GetStamp(const std::filesystem::path& path);
+    void LoadAndPublish();
+    void Run();
+
+    SnapshotHolder& holder_;
+    std::filesystem::path path_;
+    std::chrono::milliseconds poll_interval_;
+    FileStamp stamp_;
+    std::mutex mutex_;
+    std::condition_variable wakeup_;
+    bool reload_requested_ = false;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+}  // namespace snapshot
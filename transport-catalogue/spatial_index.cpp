@@ -0,0 +1,156 @@
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+
+namespace geo {
+
+namespace {
+
+constexpr double kEarthRadius = 6371000;
+constexpr double kPi = 3.1415926535;
+constexpr double kDegreesToRadians = kPi / 180.;
+
+void ToUnitSphere(Coordinates coordinates, double* position) {
+    const double lat = coordinates.lat * kDegreesToRadians;
+    const double lng = coordinates.lng * kDegreesToRadians;
+    position[0] = std::cos(lat) * std::cos(lng);
+    position[1] = std::cos(lat) * std::sin(lng);
+    position[2] = std::sin(lat);
+}
+
+double SquaredChord(const double* lhs, const double* rhs) {
+    double result = 0;
+    for (int i = 0; i < 3; ++i) {
+        const double diff = lhs[i] - rhs[i];
+        result += diff * diff;
+    }
+    return result;
+}
+
+}  // namespace
+
+struct SpatialIndex::Query {
+    double position[3];
+    size_t limit;
+    // Квадрат хорды, дальше которого точки не нужны; сужается, когда набрано limit точек
+    double bound;
+    // Квадрат хорды и item точки; вершина кучи — самый дальний из найденных, а из равноудалённых —
+    // с наибольшим item, так что набор из limit точек не зависит от порядка обхода дерева
+    std::priority_queue<std::pair<double, uint32_t>> found;
+};
+
+SpatialIndex::SpatialIndex(const std::vector<Coordinates>& points) {
+    nodes_.reserve(points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+        Node node{};
+        ToUnitSphere(points[i], node.position);
+        node.item = static_cast<uint32_t>(i);
+        nodes_.push_back(node);
+    }
+    Build(0, nodes_.size());
+}
+
+// Корень отрезка — медиана по оси наибольшего разброса
+void SpatialIndex::Build(size_t begin, size_t end) {
+    if (end - begin <= 1) {
+        return;
+    }
+    double low[3];
+    double high[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        low[axis] = high[axis] = nodes_[begin].position[axis];
+    }
+    for (size_t i = begin + 1; i < end; ++i) {
+        for (int axis = 0; axis < 3; ++axis) {
+            low[axis] = std::min(low[axis], nodes_[i].position[axis]);
+            high[axis] = std::max(high[axis], nodes_[i].position[axis]);
+        }
+    }
+    uint32_t axis = 0;
+    for (uint32_t candidate = 1; candidate < 3; ++candidate) {
+        if (high[candidate] - low[candidate] > high[axis] - low[axis]) {
+            axis = candidate;
+        }
+    }
+
+    const size_t middle = begin + (end - begin) / 2;
+    std::nth_element(nodes_.begin() + begin, nodes_.begin() + middle, nodes_.begin() + end,
+                     [axis](const Node& lhs, const Node& rhs) {
+                         return lhs.position[axis] < rhs.position[axis];
+                     });
+    nodes_[middle].axis = axis;
+    Build(begin, middle);
+    Build(middle + 1, end);
+}
+
+void SpatialIndex::Search(size_t begin, size_t end, Query& query) const {
+    if (begin >= end) {
+        return;
+    }
+    const size_t middle = begin + (end - begin) / 2;
+    const Node& node = nodes_[middle];
+
+    const double squared = SquaredChord(node.position, query.position);
+    if (squared <= query.bound) {
+        query.found.emplace(squared, node.item);
+        if (query.limit != 0 && query.found.size() > query.limit) {
+            query.found.pop();
+        }
+        if (query.limit != 0 && query.found.size() == query.limit) {
+            query.bound = std::min(query.bound, query.found.top().first);
+        }
+    }
+    if (end - begin == 1) {
+        return;
+    }
+
+    const double diff = query.position[node.axis] - node.position[node.axis];
+    const bool left_first = diff < 0;
+    if (left_first) {
+        Search(begin, middle, query);
+    } else {
+        Search(middle + 1, end, query);
+    }
+    // Вторая половина нужна, только если плоскость разреза ближе самого дальнего кандидата
+    if (diff * diff <= query.bound) {
+        if (left_first) {
+            Search(middle + 1, end, query);
+        } else {
+            Search(begin, middle, query);
+        }
+    }
+}
+
+std::vector<SpatialIndex::Neighbor> SpatialIndex::FindNearest(Coordinates center, size_t limit,
+                                                              double max_distance) const {
+    Query query;
+    ToUnitSphere(center, query.position);
+    query.limit = limit;
+    query.bound = std::numeric_limits<double>::infinity();
+    if (std::isfinite(max_distance)) {
+        // Хорда, стягивающая дугу max_distance, с запасом на округление:
+        // точное сравнение — по длине дуги ниже
+        const double angle = std::min(max_distance / kEarthRadius, kPi);
+        const double chord = 2 * std::sin(angle / 2);
+        query.bound = chord * chord * (1 + 1e-9) + 1e-18;
+    }
+    Search(0, nodes_.size(), query);
+
+    std::vector<Neighbor> result(query.found.size());
+    for (size_t i = result.size(); i > 0; --i) {
+        const auto [squared, item] = query.found.top();
+        query.found.pop();
+        // Длина дуги по хорде: 2R·asin(c/2)
+        const double chord = std::sqrt(squared);
+        result[i - 1] = {item, 2 * kEarthRadius * std::asin(std::min(1.0, chord / 2))};
+    }
+    result.erase(std::remove_if(result.begin(), result.end(), [max_distance](const Neighbor& neighbor) {
+        return neighbor.distance > max_distance;
+    }), result.end());
+    return result;
+}
+
+}  // namespace geo
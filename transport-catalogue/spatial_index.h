@@ -0,0 +1,51 @@
+#pragma once
+
+#include "geo.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace geo {
+
+// Статическое k-d дерево по точкам земной поверхности. Точки переводятся в
+// декартовы координаты на единичной сфере: длина хорды монотонна по расстоянию
+// вдоль поверхности, поэтому отсечение по хорде точное. Дерево неявное —
+// узлы лежат в одном массиве, медиана отрезка является корнем поддерева.
+class SpatialIndex {
+public:
+    struct Neighbor {
+        uint32_t item;
+        // Расстояние по поверхности в метрах
+        double distance;
+    };
+
+    SpatialIndex() = default;
+    // item — номер точки во входном массиве, он же возвращается в результатах
+    explicit SpatialIndex(const std::vector<Coordinates>& points);
+
+    // Не более limit ближайших точек не дальше max_distance метров,
+    // по возрастанию расстояния. limit == 0 — без ограничения по количеству.
+    // Из точек на одном расстоянии выбираются точки с меньшим item
+    std::vector<Neighbor> FindNearest(Coordinates center, size_t limit, double max_distance) const;
+
+    size_t GetSize() const {
+        return nodes_.size();
+    }
+
+private:
+    struct Node {
+        double position[3];
+        uint32_t item;
+        uint32_t axis;
+    };
+
+    struct Query;
+
+    void Build(size_t begin, size_t end);
+    void Search(size_t begin, size_t end, Query& query) const;
+
+    std::vector<Node> nodes_;
+};
+
+}  // namespace geo
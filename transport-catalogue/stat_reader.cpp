@@ -16,16 +16,18 @@ void PrintBus(const TransportCatalogue& catalogue, std::string_view left, std::s
 }
 
 void PrintStop(const TransportCatalogue& catalogue, std::string_view left, std::string_view right, std::ostream& output) {
-    BusesForStop answer = catalogue.GetBusesForStop(right);
     output << left << " " << right << ":";
-    if (answer.request_status == "not found") {
+    if (!catalogue.GetStop(right)) {
         output << " not found";
-    } else if (answer.request_status == "empty") {
+        return;
+    }
+    const auto& buses = catalogue.GetBusesForStop(right);
+    if (buses.empty()) {
         output << " no buses";
-    } else if (answer.request_status == "found") {
+    } else {
         output << " buses";
-        for (auto s : answer.buses) {
-            output << " " << s;
+        for (NameId bus : buses) {
+            output << " " << catalogue.GetNames().GetName(bus);
         }
     }
 }
@@ -0,0 +1,64 @@
+#include "testing.h"
+
+#include "json.h"
+#include "json_reader.h"
+#include "json_writer.h"
+#include "transport_catalogue.h"
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+using namespace std::literals;
+
+namespace {
+
+// base_requests из stop_count остановок, где элемент с номером untyped — без type
+std::string MakeBaseWithUntypedRequest(size_t stop_count, size_t untyped) {
+    std::string text = R"({"base_requests": [)";
+    for (size_t i = 0; i < stop_count; ++i) {
+        text += i == 0 ? "" : ",\n";
+        text += i == untyped ? "{" : R"({"type": "Stop", )";
+        text += R"("name": "Stop )" + std::to_string(i) + R"(", "latitude": 55.6, "longitude": 37.6})";
+    }
+    return text + "]}";
+}
+
+// Сообщение ошибки загрузки или пустая строка, если загрузка прошла
+std::string GetLoadError(std::string_view text, size_t max_threads) {
+    try {
+        catalogue::TransportCatalogue catalogue;
+        json_reader::LoadBaseRequests(text, catalogue, max_threads);
+    } catch (const std::invalid_argument& e) {
+        return e.what();
+    }
+    return {};
+}
+
+// Элемент base_requests без type — ошибка с его номером, как при разборе текста
+// в один поток и по кускам, так и из CBOR
+void TestBaseRequestWithoutType() {
+    const std::string expected = "base_requests[3]: Base request requires type";
+    const std::string small = MakeBaseWithUntypedRequest(10, 3);
+    CHECK(GetLoadError(small, 1) == expected);
+
+    std::string cbor;
+    json::Writer(cbor, json::Format::kCbor).Value(json::Load(small).GetRoot());
+    CHECK(GetLoadError(cbor, 1) == expected);
+
+    // Больше 3 МБ: текст разбирается тремя кусками, ошибочный элемент в последнем
+    constexpr size_t kStops = 50000;
+    const std::string large = MakeBaseWithUntypedRequest(kStops, kStops - 5);
+    const std::string large_expected = "base_requests[" + std::to_string(kStops - 5) + "]: Base request requires type";
+    CHECK(GetLoadError(large, 4) == large_expected);
+    CHECK(GetLoadError(large, 1) == large_expected);
+
+    CHECK(GetLoadError(MakeBaseWithUntypedRequest(10, 10), 1).empty());
+}
+
+}  // namespace
+
+int main() {
+    testing::RunTest("TestBaseRequestWithoutType", TestBaseRequestWithoutType);
+    return testing::Finish();
+}
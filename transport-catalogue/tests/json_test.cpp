@@ -0,0 +1,79 @@
+#include "testing.h"
+
+#include "json.h"
+#include "json_cbor.h"
+
+#include <string>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+constexpr std::string_view kLongKey = "a_very_long_key_name_exceeding_15"sv;
+
+// Документ, разобранный после уничтожения первого, обычно получает ту же память:
+// висячий ключ тогда читает чужие байты даже без санитайзера
+void OverwriteFreedArenas() {
+    std::vector<json::Document> documents;
+    for (int i = 0; i < 8; ++i) {
+        documents.push_back(json::Load(R"({"b_very_long_key_name_exceeding_15":2})"sv));
+    }
+}
+
+void CheckCopiedDict(const json::Node& copy) {
+    CHECK(copy.IsDict());
+    const auto& dict = copy.AsDict();
+    CHECK(dict.size() == 1);
+    for (const auto& [key, value] : dict) {
+        CHECK(std::string_view(key) == kLongKey);
+        CHECK(value.AsInt() == 1);
+    }
+    CHECK(dict.count(kLongKey) == 1);
+}
+
+void TestCopyOutlivesTextDocument() {
+    json::Node copy;
+    {
+        const auto document = json::Load(R"({"a_very_long_key_name_exceeding_15":1})"sv);
+        copy = document.GetRoot();
+    }
+    OverwriteFreedArenas();
+    CheckCopiedDict(copy);
+}
+
+void TestCopyOutlivesCborDocument() {
+    std::string cbor;
+    json::detail::WriteCborHeader(5, 1, cbor);
+    json::detail::WriteCborText(kLongKey, cbor);
+    json::detail::WriteCborInt(1, cbor);
+
+    json::Node copy;
+    {
+        const auto document = json::Load(cbor);
+        copy = document.GetRoot();
+    }
+    OverwriteFreedArenas();
+    CheckCopiedDict(copy);
+}
+
+void TestKeyCopies() {
+    const json::Key heap_key(kLongKey);
+    json::Key copy = heap_key;
+    CHECK(copy == heap_key);
+    CHECK(std::string_view(copy) == kLongKey);
+
+    const json::Key short_key("name"sv);
+    copy = short_key;
+    CHECK(copy == json::keys::kName);
+    CHECK(!(copy < short_key) && !(short_key < copy));
+}
+
+}  // namespace
+
+int main() {
+    testing::RunTest("TestCopyOutlivesTextDocument", TestCopyOutlivesTextDocument);
+    testing::RunTest("TestCopyOutlivesCborDocument", TestCopyOutlivesCborDocument);
+    testing::RunTest("TestKeyCopies", TestKeyCopies);
+    return testing::Finish();
+}
@@ -0,0 +1,154 @@
+#include "testing.h"
+
+#include "map_renderer.h"
+#include "serialization.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std::literals;
+
+namespace {
+
+constexpr int kReaders = 4;
+constexpr int kStops = 200;
+constexpr int kStopsPerBus = 10;
+
+// Сетка остановок и маршруты по kStopsPerBus подряд идущих остановок.
+// Основной объём базы — матрица маршрутов: (2 * kStops)^2 записей
+void WriteBase(const std::filesystem::path& path) {
+    catalogue::TransportCatalogue catalogue;
+    std::vector<std::string> names;
+    for (int i = 0; i < kStops; ++i) {
+        names.push_back("Stop " + std::to_string(i));
+        catalogue.AddStop(names.back(), 55.0 + 0.001 * (i / 20), 37.0 + 0.001 * (i % 20));
+    }
+    for (int first = 0; first + kStopsPerBus <= kStops; first += kStopsPerBus / 2) {
+        std::vector<std::string_view> stops(names.begin() + first, names.begin() + first + kStopsPerBus);
+        catalogue.AddBus("Bus " + std::to_string(first), stops, false);
+    }
+    catalogue.Freeze();
+
+    TransportRouter router(catalogue, RoutingSettings{6, 40});
+    router.BuildGraph();
+    serialization::SaveBase(path, catalogue, renderer::GetDefaultRenderSettings(), router);
+}
+
+// Процесс-читатель: отвечает на запросы по отображённой базе и читает всю матрицу,
+// затем сообщает о готовности и ждёт, пока родитель не закроет канал
+[[noreturn]] void RunReader(const std::filesystem::path& path, int ready_fd, int release_fd) {
+    int status = 0;
+    try {
+        serialization::MappedBase base(path);
+        catalogue::TransportCatalogue catalogue;
+        base.FillCatalogue(catalogue);
+        const auto router = base.MakeRouter(catalogue);
+        if (!router->GetRoute("Stop 0"sv, "Stop 199"sv)) {
+            status = 2;
+        }
+        const auto& matrix = router->GetRouter();
+        uint64_t checksum = 0;
+        for (size_t i = 0; i < matrix.GetRoutesInternalDataSize(); ++i) {
+            checksum += matrix.GetRoutesInternalData()[i].prev_edge;
+        }
+        const char ready = checksum != 0 ? 'r' : 'e';
+        if (::write(ready_fd, &ready, 1) != 1) {
+            status = 3;
+        }
+        char ignored;
+        while (::read(release_fd, &ignored, 1) > 0) {
+        }
+    } catch (...) {
+        status = 1;
+    }
+    ::_exit(status);
+}
+
+struct MappingUsage {
+    uint64_t rss_kb = 0;
+    uint64_t pss_kb = 0;
+};
+
+// Rss и Pss отображения файла path в процессе pid по /proc/<pid>/smaps
+MappingUsage ReadMappingUsage(pid_t pid, const std::filesystem::path& path) {
+    std::ifstream smaps("/proc/" + std::to_string(pid) + "/smaps");
+    const std::string suffix = " " + path.string();
+    MappingUsage usage;
+    bool inside = false;
+    for (std::string line; std::getline(smaps, line);) {
+        const bool is_header = !line.empty() && line.find(':') > line.find(' ');
+        if (is_header) {
+            inside = line.size() >= suffix.size() && line.compare(line.size() - suffix.size(), suffix.size(), suffix) == 0;
+        } else if (inside && line.rfind("Rss:", 0) == 0) {
+            usage.rss_kb += std::stoull(line.substr(4));
+        } else if (inside && line.rfind("Pss:", 0) == 0) {
+            usage.pss_kb += std::stoull(line.substr(4));
+        }
+    }
+    return usage;
+}
+
+// Несколько процессов над одной базой держат в памяти одну копию её страниц:
+// Pss отображения у каждого — примерно размер файла, делённый на число читателей
+void TestReadersShareMappedBase() {
+    const auto path = std::filesystem::temp_directory_path()
+                      / ("transport_catalogue_shared_" + std::to_string(::getpid()) + ".db");
+    WriteBase(path);
+    const uint64_t file_kb = std::filesystem::file_size(path) / 1024;
+
+    int ready[2];
+    int release[2];
+    CHECK(::pipe(ready) == 0 && ::pipe(release) == 0);
+    std::vector<pid_t> readers;
+    for (int i = 0; i < kReaders; ++i) {
+        const pid_t pid = ::fork();
+        if (pid == 0) {
+            ::close(ready[0]);
+            ::close(release[1]);
+            RunReader(path, ready[1], release[0]);
+        }
+        CHECK(pid > 0);
+        readers.push_back(pid);
+    }
+    ::close(ready[1]);
+    ::close(release[0]);
+
+    for (int i = 0; i < kReaders; ++i) {
+        char state = 0;
+        CHECK(::read(ready[0], &state, 1) == 1 && state == 'r');
+    }
+    for (pid_t pid : readers) {
+        const MappingUsage usage = ReadMappingUsage(pid, path);
+        std::cerr << "reader " << pid << ": file " << file_kb << " kB, mapping Rss " << usage.rss_kb
+                  << " kB, Pss " << usage.pss_kb << " kB\n";
+        // Матрица прочитана целиком, значит страницы базы действительно в памяти процесса
+        CHECK(usage.rss_kb * 2 >= file_kb);
+        // Своей копии нет: доля процесса — 1/kReaders с запасом на неполные страницы
+        CHECK(usage.pss_kb * kReaders <= usage.rss_kb * 5 / 4 + 16);
+        CHECK(usage.pss_kb * 2 < file_kb);
+    }
+
+    ::close(release[1]);
+    ::close(ready[0]);
+    for (pid_t pid : readers) {
+        int status = 0;
+        CHECK(::waitpid(pid, &status, 0) == pid);
+        CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    std::filesystem::remove(path);
+}
+
+}  // namespace
+
+int main() {
+    testing::RunTest("TestReadersShareMappedBase", TestReadersShareMappedBase);
+    return testing::Finish();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <functional>
+#include <iostream>
+#include <string_view>
+
+// Минимум для тестов без сторонних библиотек: CHECK отмечает провал и продолжает,
+// RunTest ловит исключения, main возвращает Finish()
+namespace testing {
+
+inline int& FailureCount() {
+    static int count = 0;
+    return count;
+}
+
+inline void Check(bool condition, std::string_view expression, std::string_view file, int line) {
+    if (!condition) {
+        std::cerr << file << ':' << line << ": CHECK failed: " << expression << '\n';
+        ++FailureCount();
+    }
+}
+
+inline void RunTest(std::string_view name, const std::function<void()>& test) {
+    const int failures_before = FailureCount();
+    try {
+        test();
+    } catch (const std::exception& e) {
+        std::cerr << name << ": unexpected exception: " << e.what() << '\n';
+        ++FailureCount();
+    }
+    std::cerr << (FailureCount() == failures_before ? "ok   " : "FAIL ") << name << '\n';
+}
+
+inline int Finish() {
+    return FailureCount() == 0 ? 0 : 1;
+}
+
+}  // namespace testing
+
+#define CHECK(condition) ::testing::Check(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
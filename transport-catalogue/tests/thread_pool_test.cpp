@@ -0,0 +1,229 @@
+#include "testing.h"
+
+#include "json_reader.h"
+#include "thread_pool.h"
+#include "transport_catalogue.h"
+
+#include <atomic>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Тесты многопоточного кода; смысл в основном под -DTRANSPORT_CATALOGUE_SANITIZE=thread.
+// Число потоков задаётся явно, так что кража работы и параллельный разбор
+// проверяются и на машине с одним ядром
+namespace {
+
+constexpr size_t kThreads = 8;
+
+// Дорогие задачи собраны в начале диапазона: их часть достаётся одному потоку,
+// и остальные, закончив свои, крадут у него
+uint64_t Work(size_t index) {
+    const size_t steps = index < 64 ? 20000 : 10;
+    uint64_t value = index;
+    for (size_t i = 0; i < steps; ++i) {
+        value = value * 6364136223846793005ull + 1442695040888963407ull;
+    }
+    return value;
+}
+
+void TestEachIndexRunsOnce() {
+    thread_pool::ThreadPool pool(kThreads);
+    CHECK(pool.GetThreadCount() == kThreads);
+    for (const size_t count : {size_t{0}, size_t{1}, size_t{2}, size_t{7}, size_t{1000}, size_t{100000}}) {
+        // Обычные int: каждый элемент пишет ровно одна задача, гонку увидит TSan
+        std::vector<int> hits(count);
+        std::vector<uint64_t> results(count);
+        std::atomic<size_t> calls = 0;
+        pool.ParallelFor(count, [&](size_t index) {
+            ++hits[index];
+            results[index] = Work(index);
+            calls.fetch_add(1, std::memory_order_relaxed);
+        });
+        CHECK(calls == count);
+        bool all_once = true;
+        bool all_correct = true;
+        for (size_t index = 0; index < count; ++index) {
+            all_once = all_once && hits[index] == 1;
+            all_correct = all_correct && results[index] == Work(index);
+        }
+        CHECK(all_once);
+        CHECK(all_correct);
+    }
+}
+
+// Пул переиспользуется от вызова к вызову; результаты предыдущего видны следующему
+void TestRepeatedCalls() {
+    thread_pool::ThreadPool pool(kThreads);
+    std::vector<uint64_t> values(5000, 0);
+    for (int round = 0; round < 50; ++round) {
+        pool.ParallelFor(values.size(), [&](size_t index) {
+            values[index] += index + 1;
+        });
+    }
+    bool correct = true;
+    for (size_t index = 0; index < values.size(); ++index) {
+        correct = correct && values[index] == 50 * (index + 1);
+    }
+    CHECK(correct);
+}
+
+void TestRethrowsLowestIndex() {
+    thread_pool::ThreadPool pool(kThreads);
+    std::atomic<size_t> calls = 0;
+    std::string message;
+    try {
+        pool.ParallelFor(10000, [&](size_t index) {
+            calls.fetch_add(1, std::memory_order_relaxed);
+            if (index == 500 || index == 7000 || index == 9999) {
+                throw std::runtime_error(std::to_string(index));
+            }
+        });
+    } catch (const std::runtime_error& e) {
+        message = e.what();
+    }
+    CHECK(message == "500");
+    // Исключение не останавливает остальные задачи
+    CHECK(calls == 10000);
+}
+
+// Документ с base_requests из stop_count остановок и маршрутов по 20 остановок;
+// sections дописываются после base_requests
+std::string MakeDocument(size_t stop_count, std::string_view sections = {}) {
+    std::string text = R"({"base_requests": [)";
+    for (size_t i = 0; i < stop_count; ++i) {
+        const std::string index = std::to_string(i);
+        // Каждое десятое имя с экранированием: такие строки хранит Reader куска
+        const std::string name = i % 10 == 0 ? "Stop \\\"" + index + "\\\"" : "Stop " + index;
+        const std::string next = (i + 1) % 10 == 0 ? "Stop \\\"" + std::to_string(i + 1) + "\\\""
+                                                   : "Stop " + std::to_string(i + 1);
+        text += R"({"type": "Stop", "name": ")" + name + R"(", "latitude": )"
+                + std::to_string(55.0 + 0.0001 * static_cast<double>(i % 1000))
+                + R"(, "longitude": )" + std::to_string(37.0 + 0.0001 * static_cast<double>(i / 1000))
+                + R"(, "road_distances": {")" + next + R"(": )" + std::to_string(100 + i % 900) + "}},\n";
+        if (i % 20 == 19) {
+            text += R"({"type": "Bus", "name": "Bus )" + index + R"(", "is_roundtrip": false, "stops": [)";
+            for (size_t stop = i - 19; stop <= i; ++stop) {
+                const std::string stop_index = std::to_string(stop);
+                text += stop % 10 == 0 ? "\"Stop \\\"" + stop_index + "\\\"\"" : "\"Stop " + stop_index + "\"";
+                text += stop == i ? "]},\n" : ", ";
+            }
+        }
+    }
+    text += R"({"type": "Stop", "name": "Last", "latitude": 56, "longitude": 38, "road_distances": {}}])";
+    text += sections;
+    text += '}';
+    return text;
+}
+
+void TestParallelParseMatchesSerial() {
+    // Несколько кусков разбора: кусок — не меньше 1 МБ
+    const std::string text = MakeDocument(40000);
+    CHECK(text.size() > 4 * (size_t{1} << 20));
+
+    catalogue::TransportCatalogue serial;
+    json_reader::LoadBaseRequests(text, serial, 1);
+    catalogue::TransportCatalogue parallel;
+    json_reader::LoadBaseRequests(text, parallel, kThreads);
+
+    CHECK(serial.GetStops().size() == 40001);
+    CHECK(parallel.GetStops().size() == serial.GetStops().size());
+    CHECK(parallel.GetBuses().size() == serial.GetBuses().size());
+    CHECK(parallel.GetDistances().size() == serial.GetDistances().size());
+    bool same_stops = true;
+    for (auto lhs = serial.GetStops().begin(), rhs = parallel.GetStops().begin();
+         lhs != serial.GetStops().end() && rhs != parallel.GetStops().end(); ++lhs, ++rhs) {
+        same_stops = same_stops && lhs->name == rhs->name && lhs->coordinates == rhs->coordinates;
+    }
+    CHECK(same_stops);
+    bool same_buses = true;
+    for (auto lhs = serial.GetBuses().begin(), rhs = parallel.GetBuses().begin();
+         lhs != serial.GetBuses().end() && rhs != parallel.GetBuses().end(); ++lhs, ++rhs) {
+        const auto lhs_stats = serial.GetBusStatistics(lhs->name);
+        const auto rhs_stats = parallel.GetBusStatistics(rhs->name);
+        same_buses = same_buses && lhs->name == rhs->name && lhs->stops == rhs->stops
+                     && lhs_stats.length == rhs_stats.length && lhs_stats.geo_length == rhs_stats.geo_length;
+    }
+    CHECK(same_buses);
+    CHECK(parallel.GetStop("Stop \"10\"") != nullptr);
+}
+
+std::string MakeStatRequests(size_t stop_count, size_t request_count) {
+    std::string text = R"(, "stat_requests": [)";
+    for (size_t id = 0; id < request_count; ++id) {
+        const size_t stop = id * 7919 % stop_count;
+        const std::string stop_name = stop % 10 == 0 ? "Stop \\\"" + std::to_string(stop) + "\\\""
+                                                     : "Stop " + std::to_string(stop);
+        const std::string other = "Stop " + std::to_string((stop * 31 + 7) % stop_count / 10 * 10 + 1);
+        const std::string request_id = std::to_string(id);
+        switch (id % 6) {
+            case 0:
+                text += R"({"id": )" + request_id + R"(, "type": "Bus", "name": "Bus )"
+                        + std::to_string(stop / 20 * 20 + 19) + "\"}";
+                break;
+            case 1:
+                text += R"({"id": )" + request_id + R"(, "type": "Stop", "name": ")" + stop_name + "\"}";
+                break;
+            case 2:
+                text += R"({"id": )" + request_id + R"(, "type": "Route", "from": ")" + stop_name
+                        + R"(", "to": ")" + other + "\"}";
+                break;
+            case 3:
+                text += R"({"id": )" + request_id + R"(, "type": "Nearby", "latitude": 55.01, "longitude": 37, "count": 5})";
+                break;
+            case 4:
+                text += R"({"id": )" + request_id + R"(, "type": "Suggest", "prefix": "Stop 1", "count": 3})";
+                break;
+            default:
+                // Карта строится один раз на все потоки; ответ с ошибкой тоже должен встать на место
+                text += R"({"id": )" + request_id + (id % 300 == 5 ? R"(, "type": "Map"})" : R"(, "type": "Unknown"})");
+                break;
+        }
+        text += id + 1 == request_count ? "]" : ",\n";
+    }
+    return text;
+}
+
+// Ответы пула совпадают с последовательными байт в байт, в тексте и в CBOR
+void TestParallelResponsesMatchSerial() {
+    constexpr size_t kStops = 200;
+    const std::string text = MakeDocument(kStops, R"(, "routing_settings": {"bus_wait_time": 6, "bus_velocity": 40},
+        "render_settings": {"width": 600, "height": 400, "padding": 50, "stop_radius": 5, "line_width": 14,
+        "bus_label_font_size": 20, "bus_label_offset": [7, 15], "stop_label_font_size": 20,
+        "stop_label_offset": [7, -3], "underlayer_color": [255, 255, 255, 0.85], "underlayer_width": 3,
+        "color_palette": ["green", [255, 160, 0], "red"]})" + MakeStatRequests(kStops, 3000));
+    catalogue::TransportCatalogue catalogue;
+    const auto doc = json_reader::LoadBaseRequests(text, catalogue);
+    catalogue.Freeze();
+    const auto render_settings = json_reader::ParseRenderSettings(doc);
+
+    for (const auto format : {json::Format::kText, json::Format::kCbor}) {
+        std::ostringstream serial;
+        json_reader::SetResponseThreads(1);
+        json_reader::ProcessRequests(doc, catalogue, render_settings, serial, format);
+        std::ostringstream parallel;
+        json_reader::SetResponseThreads(kThreads);
+        json_reader::ProcessRequests(doc, catalogue, render_settings, parallel, format);
+        CHECK(serial.str().size() > 100000);
+        if (format == json::Format::kText) {
+            // В ответах есть маршруты и карта, а не одни ошибки
+            CHECK(serial.str().find("\"total_time\"") != std::string::npos);
+            CHECK(serial.str().find("\"map\"") != std::string::npos);
+        }
+        CHECK(parallel.str() == serial.str());
+    }
+    json_reader::SetResponseThreads(0);
+}
+
+}  // namespace
+
+int main() {
+    testing::RunTest("TestEachIndexRunsOnce", TestEachIndexRunsOnce);
+    testing::RunTest("TestRepeatedCalls", TestRepeatedCalls);
+    testing::RunTest("TestRethrowsLowestIndex", TestRethrowsLowestIndex);
+    testing::RunTest("TestParallelParseMatchesSerial", TestParallelParseMatchesSerial);
+    testing::RunTest("TestParallelResponsesMatchSerial", TestParallelResponsesMatchSerial);
+    return testing::Finish();
+}
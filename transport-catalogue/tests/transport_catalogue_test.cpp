@@ -0,0 +1,93 @@
+#include "testing.h"
+
+#include "geo.h"
+#include "perfect_hash.h"
+#include "transport_catalogue.h"
+
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+// Повтор имени остановки заменяет её координаты, и Freeze строит индексы без дублей
+void TestDuplicateStopName() {
+    catalogue::TransportCatalogue catalogue;
+    catalogue.AddStop("A"sv, 55.0, 37.0);
+    catalogue.AddStop("B"sv, 55.01, 37.01);
+    catalogue.SetDistance("A"sv, "B"sv, 1000);
+    catalogue.AddBus("1"sv, {"A"sv, "B"sv}, false);
+    const double geo_before = catalogue.GetBusStatistics("1"sv).geo_length;
+
+    catalogue.AddStop("A"sv, 55.02, 37.02);
+    catalogue.Freeze();
+
+    CHECK(catalogue.GetStops().size() == 2);
+    CHECK(catalogue.GetAllStops().size() == 2);
+    const auto* stop = catalogue.GetStop("A"sv);
+    CHECK(stop && stop->coordinates == (geo::Coordinates{55.02, 37.02}));
+    CHECK(catalogue.FindName("A"sv) == stop->id);
+    // Расстояние, заданное до повтора, относится к той же остановке
+    CHECK(catalogue.GetDistance(stop, catalogue.GetStop("B"sv)) == 1000);
+
+    const auto statistics = catalogue.GetBusStatistics("1"sv);
+    CHECK(statistics.length == 2000);
+    CHECK(statistics.geo_length != geo_before);
+
+    const auto nearby = catalogue.GetStopsNearby({55.02, 37.02}, 0, 1e9);
+    CHECK(nearby.size() == 2);
+    CHECK(!nearby.empty() && nearby.front().stop == stop);
+    CHECK(catalogue.SuggestNames("A"sv, 10).size() == 1);
+}
+
+void TestPerfectHashRejectsDuplicateKeys() {
+    const std::vector<std::string_view> keys{"A"sv, "B"sv, "A"sv};
+    bool thrown = false;
+    try {
+        perfect_hash::PerfectHash::Build(keys);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+// Изменения между заморозками: маршруты, добавленные и перестроенные после Freeze,
+// находятся без перестройки CSR, а устаревшие его записи не учитываются
+void TestDeltaBetweenFreezes() {
+    catalogue::TransportCatalogue catalogue;
+    catalogue.AddStop("A"sv, 55.0, 37.0);
+    catalogue.AddStop("B"sv, 55.01, 37.01);
+    catalogue.AddStop("C"sv, 55.02, 37.02);
+    catalogue.SetDistance("A"sv, "B"sv, 1000);
+    catalogue.SetDistance("B"sv, "C"sv, 1000);
+    catalogue.AddBus("1"sv, {"A"sv, "B"sv}, false);
+    catalogue.Freeze();
+
+    catalogue::Invalidation invalidation;
+    catalogue.UpsertBus("2"sv, {"B"sv, "C"sv}, false, invalidation);
+    catalogue.UpsertBus("1"sv, {"A"sv, "C"sv}, false, invalidation);
+    catalogue.UpdateDistance("B"sv, "C"sv, 3000, invalidation);
+    CHECK(catalogue.GetBusStatistics("2"sv).length == 6000);
+    catalogue::Invalidation distance_only;
+    catalogue.UpdateDistance("A"sv, "B"sv, 500, distance_only);
+    // Маршрут 1 больше не проходит через B, хотя в CSR он ещё записан у B
+    CHECK(distance_only.changed_buses.empty());
+
+    catalogue.RemoveStop("C"sv, invalidation);
+    CHECK(catalogue.GetBus("1"sv) == nullptr);
+    CHECK(catalogue.GetBus("2"sv) == nullptr);
+    catalogue.Freeze();
+    CHECK(catalogue.GetBusesForStop("A"sv).empty());
+    CHECK(catalogue.GetBusesForStop("B"sv).empty());
+}
+
+}  // namespace
+
+int main() {
+    testing::RunTest("TestDuplicateStopName", TestDuplicateStopName);
+    testing::RunTest("TestPerfectHashRejectsDuplicateKeys", TestPerfectHashRejectsDuplicateKeys);
+    testing::RunTest("TestDeltaBetweenFreezes", TestDeltaBetweenFreezes);
+    return testing::Finish();
+}
@@ -0,0 +1,143 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace thread_pool {
+
+ThreadPool::ThreadPool(size_t threads)
+    : ranges_(threads != 0 ? threads : std::max<size_t>(std::thread::hardware_concurrency(), 1)) {
+    workers_.reserve(ranges_.size() - 1);
+    for (size_t worker = 1; worker < ranges_.size(); ++worker) {
+        workers_.emplace_back([this, worker] {
+            WorkerLoop(worker);
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard guard(mutex_);
+        stopping_ = true;
+    }
+    job_ready_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& task) {
+    // Рабочие потоки читают task_ только после ++generation_ под mutex_
+    task_ = &task;
+    error_ = nullptr;
+    if (workers_.empty() || count <= 1) {
+        for (size_t index = 0; index < count; ++index) {
+            Run(index);
+        }
+    } else {
+        const size_t threads = ranges_.size();
+        for (size_t worker = 0; worker < threads; ++worker) {
+            std::lock_guard guard(ranges_[worker].mutex);
+            ranges_[worker].begin = count * worker / threads;
+            ranges_[worker].end = count * (worker + 1) / threads;
+        }
+        {
+            std::lock_guard guard(mutex_);
+            busy_workers_ = workers_.size();
+            ++generation_;
+        }
+        job_ready_.notify_all();
+
+        RunTasks(0);
+        std::unique_lock lock(mutex_);
+        job_done_.wait(lock, [this] {
+            return busy_workers_ == 0;
+        });
+    }
+    task_ = nullptr;
+
+    if (error_) {
+        std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+}
+
+void ThreadPool::WorkerLoop(size_t worker) {
+    uint64_t seen_generation = 0;
+    while (true) {
+        {
+            std::unique_lock lock(mutex_);
+            job_ready_.wait(lock, [this, seen_generation] {
+                return stopping_ || generation_ != seen_generation;
+            });
+            if (stopping_) {
+                return;
+            }
+            seen_generation = generation_;
+        }
+        RunTasks(worker);
+        std::lock_guard guard(mutex_);
+        if (--busy_workers_ == 0) {
+            job_done_.notify_one();
+        }
+    }
+}
+
+// Поток выходит, когда своя часть пуста и украсть нечего. Индексы, которые в
+// этот момент переносит другой вор, выполнит он сам
+void ThreadPool::RunTasks(size_t worker) {
+    do {
+        for (size_t index; TakeOwn(worker, index);) {
+            Run(index);
+        }
+    } while (Steal(worker));
+}
+
+bool ThreadPool::TakeOwn(size_t worker, size_t& index) {
+    Range& range = ranges_[worker];
+    std::lock_guard guard(range.mutex);
+    if (range.begin == range.end) {
+        return false;
+    }
+    index = range.begin++;
+    return true;
+}
+
+bool ThreadPool::Steal(size_t worker) {
+    const size_t threads = ranges_.size();
+    for (size_t offset = 1; offset < threads; ++offset) {
+        Range& victim = ranges_[(worker + offset) % threads];
+        size_t begin;
+        size_t end;
+        {
+            std::lock_guard guard(victim.mutex);
+            const size_t remaining = victim.end - victim.begin;
+            if (remaining == 0) {
+                continue;
+            }
+            end = victim.end;
+            begin = victim.end - (remaining + 1) / 2;
+            victim.end = begin;
+        }
+        // Своя часть пуста, и другие воры её не трогают, пока она не заполнена
+        Range& own = ranges_[worker];
+        std::lock_guard guard(own.mutex);
+        own.begin = begin;
+        own.end = end;
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::Run(size_t index) {
+    try {
+        (*task_)(index);
+    } catch (...) {
+        std::lock_guard guard(error_mutex_);
+        if (!error_ || index < error_index_) {
+            error_ = std::current_exception();
+            error_index_ = index;
+        }
+    }
+}
+
+}  // namespace thread_pool
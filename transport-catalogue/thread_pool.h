@@ -0,0 +1,68 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace thread_pool {
+
+// Пул потоков для ParallelFor с кражей работы. Диапазон индексов делится поровну
+// между потоками; поток берёт индексы своей части с начала, а закончив её, крадёт
+// с конца половину остатка у соседа. Так дорогие задачи (Map, длинный Route)
+// не задерживают остальные на одном потоке, а дешёвые почти не синхронизируются:
+// взять индекс из своей части — одна незанятая блокировка
+class ThreadPool {
+public:
+    // threads — сколько потоков выполняют задачи вместе с вызывающим;
+    // 0 — по числу аппаратных потоков. Один поток — пул без рабочих потоков
+    explicit ThreadPool(size_t threads = 0);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    size_t GetThreadCount() const {
+        return workers_.size() + 1;
+    }
+
+    // Вызывает task(i) для каждого i из [0, count) и возвращается, когда все
+    // вызовы завершены; вызывающий поток тоже выполняет задачи. Если задачи
+    // бросали исключения, после завершения всех пробрасывается то, у которого
+    // меньше индекс. Вызывать из одного потока за раз
+    void ParallelFor(size_t count, const std::function<void(size_t)>& task);
+
+private:
+    // Ещё не взятые индексы одного потока; отдельная строка кэша на поток
+    struct alignas(64) Range {
+        std::mutex mutex;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    void WorkerLoop(size_t worker);
+    void RunTasks(size_t worker);
+    bool TakeOwn(size_t worker, size_t& index);
+    bool Steal(size_t worker);
+    void Run(size_t index);
+
+    std::vector<Range> ranges_;
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable job_ready_;
+    std::condition_variable job_done_;
+    const std::function<void(size_t)>* task_ = nullptr;
+    uint64_t generation_ = 0;
+    size_t busy_workers_ = 0;
+    bool stopping_ = false;
+
+    std::mutex error_mutex_;
+    std::exception_ptr error_;
+    size_t error_index_ = 0;
+};
+
+}  // namespace thread_pool
@@ -3,25 +3,39 @@
 #include <string>
 #include <stdexcept>
 #include <unordered_set>
+#include <algorithm>
+#include <tuple>
 
 namespace catalogue {
 
-    void TransportCatalogue::AddStop(const std::string& name, double lat, double lng) {
-        stops_.push_back({name, {lat, lng}});
+    void TransportCatalogue::AddStop(std::string_view name, double lat, double lng) {
+        // Повторное описание остановки заменяет координаты прежней: указатели на неё
+        // (расстояния, маршруты) остаются действительными, а имя не попадает в индексы дважды
+        if (const auto it = stops_ptr_.find(name); it != stops_ptr_.end()) {
+            Stop* stop = it->second;
+            stop->coordinates = {lat, lng};
+            frozen_ = false;
+            RefreshBusesThrough(stop, stop, nullptr);
+            return;
+        }
+        const NameId id = names_.Intern(name);
+        stops_.push_back({names_.GetName(id), {lat, lng}, id});
         stops_ptr_[stops_.back().name] = &stops_.back();
+        frozen_ = false;
     }
 
-    void TransportCatalogue::AddBus(const std::string& name, const std::vector<std::string_view>& stops, bool is_roundtrip) {
-        std::vector<std::string> st;
-        for (std::string_view stop : stops) {
-            if (!stops_ptr_.count(stop)) {
-                return;
-            }
-            st.push_back(std::string(stop));
+    void TransportCatalogue::AddBus(std::string_view name, const std::vector<std::string_view>& stops, bool is_roundtrip) {
+        std::vector<std::string_view> st;
+        if (!ResolveStopNames(stops, st)) {
+            return;
         }
-        buses_.push_back({name, std::move(st), is_roundtrip});
+        const NameId id = names_.Intern(name);
+        buses_.push_back({names_.GetName(id), std::move(st), is_roundtrip, id});
         bus_ptr_[buses_.back().name] = &buses_.back();
-        LinkBusToStops(buses_.back().name);
+        bus_index_ready_ = false;
+        frozen_ = false;
+        NoteUnindexedBus(buses_.back());
+        RefreshBusStatistics(buses_.back(), nullptr);
     }
 
     void TransportCatalogue::SetDistance(std::string_view stop_from, std::string_view stop_to, int distance) {
@@ -29,6 +43,7 @@ namespace catalogue {
         const Stop* to = GetStop(stop_to);
         if (from && to) {
             distances_[{from, to}] = distance;
+            RefreshBusesThrough(from, to, nullptr);
         }
     }
 
@@ -48,12 +63,9 @@ namespace catalogue {
         return 0;
     }
 
-    BusCounted TransportCatalogue::CountStation(std::string_view bus_name) const {
+    BusCounted TransportCatalogue::CountStation(const Bus& bus_ref) const {
         BusCounted result;
-        auto it = bus_ptr_.find(bus_name);
-        if (it == bus_ptr_.end()) return result;
-
-        const Bus* bus = it->second;
+        const Bus* bus = &bus_ref;
         size_t n = bus->stops.size();
         if (n == 0) return result;
 
@@ -116,35 +128,441 @@ namespace catalogue {
     }
 
     BusCounted TransportCatalogue::GetBusStatistics(std::string_view bus_name) const {
-        return CountStation(bus_name);
+        auto it = bus_stats_.find(bus_name);
+        return it != bus_stats_.end() ? it->second : BusCounted{};
     }
 
-    const std::set<std::string_view>& TransportCatalogue::GetBusesForStop(std::string_view stop_name) const {
-        auto it = buses_for_stop_.find(stop_name);
-        if (it != buses_for_stop_.end()) {
-            return it->second;
-        } else {
-            static const std::set<std::string_view> empty_set;
-            return empty_set;
+    ranges::Range<const NameId*> TransportCatalogue::GetBusesForStop(std::string_view stop_name) const {
+        if (!frozen_) {
+            throw std::logic_error("Catalogue is not frozen");
+        }
+        return GetBusesForStop(FindName(stop_name));
+    }
+
+    ranges::Range<const NameId*> TransportCatalogue::GetBusesForStop(NameId stop_id) const {
+        if (stop_id == domain::kNoName || stop_id + 1 >= stop_bus_offsets_.size()) {
+            return {nullptr, nullptr};
         }
+        const NameId* data = stop_buses_.data();
+        return {data + stop_bus_offsets_[stop_id], data + stop_bus_offsets_[stop_id + 1]};
     }
 
     const Stop* TransportCatalogue::GetStop(std::string_view name) const {
+        if (frozen_) {
+            const NameSlot* slot = FindSlot(name);
+            return slot ? slot->stop : nullptr;
+        }
         auto it = stops_ptr_.find(name);
         return (it != stops_ptr_.end()) ? it->second : nullptr;
     }
 
     const Bus* TransportCatalogue::GetBus(std::string_view name) const {
+        if (frozen_) {
+            const NameSlot* slot = FindSlot(name);
+            return slot ? slot->bus : nullptr;
+        }
         auto it = bus_ptr_.find(name);
         return (it != bus_ptr_.end()) ? it->second : nullptr;
     }
 
-    void TransportCatalogue::LinkBusToStops(std::string_view bus_name) {
-        const Bus* bus = GetBus(bus_name);
-        if (!bus) return;
-        for (const auto& stop : bus->stops) {
-            buses_for_stop_[stop].insert(bus->name);
+    NameId TransportCatalogue::FindName(std::string_view name) const {
+        if (frozen_) {
+            const NameSlot* slot = FindSlot(name);
+            return !slot ? domain::kNoName : slot->stop ? slot->stop->id : slot->bus->id;
+        }
+        if (const Stop* stop = GetStop(name)) {
+            return stop->id;
+        }
+        const Bus* bus = GetBus(name);
+        return bus ? bus->id : domain::kNoName;
+    }
+
+    // Всё нужное для ответа лежит в самом слоте: имя для сверки, остановка и маршрут
+    const TransportCatalogue::NameSlot* TransportCatalogue::FindSlot(std::string_view name) const {
+        if (name_slots_.empty()) {
+            return nullptr;
+        }
+        const NameSlot& slot = name_slots_[name_index_(name)];
+        return slot.name == name ? &slot : nullptr;
+    }
+
+    std::vector<NearbyStop> TransportCatalogue::GetStopsNearby(geo::Coordinates center, size_t limit,
+                                                               double max_distance) const {
+        if (!frozen_) {
+            throw std::logic_error("Catalogue is not frozen");
+        }
+        std::vector<NearbyStop> result;
+        for (const auto& neighbor : stop_locations_.FindNearest(center, limit, max_distance)) {
+            result.push_back({indexed_stops_[neighbor.item], neighbor.distance});
+        }
+        std::sort(result.begin(), result.end(), [](const NearbyStop& lhs, const NearbyStop& rhs) {
+            return std::tie(lhs.distance, lhs.stop->name) < std::tie(rhs.distance, rhs.stop->name);
+        });
+        return result;
+    }
+
+    std::vector<NameMatch> TransportCatalogue::SuggestNames(std::string_view prefix, size_t limit) const {
+        if (!frozen_) {
+            throw std::logic_error("Catalogue is not frozen");
+        }
+        std::vector<NameMatch> result;
+        for (uint32_t slot_index : name_prefixes_.FindByPrefix(prefix, limit)) {
+            const NameSlot& slot = name_slots_[slot_index];
+            result.push_back({slot.name, slot.stop, slot.bus});
+        }
+        return result;
+    }
+
+    const NameArena& TransportCatalogue::GetNames() const {
+        return names_;
+    }
+
+    void TransportCatalogue::Freeze() {
+        Freeze({});
+    }
+
+    void TransportCatalogue::Freeze(perfect_hash::PerfectHash name_index) {
+        if (frozen_) {
+            return;
+        }
+        BuildBusIndex();
+
+        // Остановка и маршрут могут называться одинаково — тогда у имени один слот
+        std::vector<NameSlot> entries;
+        std::vector<size_t> entry_by_id(names_.GetCount(), SIZE_MAX);
+        for (const Stop& stop : stops_) {
+            entry_by_id[stop.id] = entries.size();
+            entries.push_back({stop.name, &stop, nullptr});
         }
+        for (const Bus& bus : buses_) {
+            if (entry_by_id[bus.id] == SIZE_MAX) {
+                entry_by_id[bus.id] = entries.size();
+                entries.push_back({bus.name, nullptr, &bus});
+            } else {
+                entries[entry_by_id[bus.id]].bus = &bus;
+            }
+        }
+
+        // Точки индекса идут по имени: при равных расстояниях индекс отдаёт меньший номер,
+        // и ответ не зависит от порядка добавления остановок
+        indexed_stops_.clear();
+        for (const Stop& stop : stops_) {
+            indexed_stops_.push_back(&stop);
+        }
+        std::sort(indexed_stops_.begin(), indexed_stops_.end(), [](const Stop* lhs, const Stop* rhs) {
+            return lhs->name < rhs->name;
+        });
+        std::vector<geo::Coordinates> locations;
+        locations.reserve(indexed_stops_.size());
+        for (const Stop* stop : indexed_stops_) {
+            locations.push_back(stop->coordinates);
+        }
+        stop_locations_ = geo::SpatialIndex(locations);
+
+        name_index_ = std::move(name_index);
+        if (!TryUseNameIndex(entries)) {
+            std::vector<std::string_view> keys;
+            keys.reserve(entries.size());
+            for (const NameSlot& entry : entries) {
+                keys.push_back(entry.name);
+            }
+            name_index_ = perfect_hash::PerfectHash::Build(keys);
+            if (!TryUseNameIndex(entries)) {
+                throw std::logic_error("Perfect hash does not fit catalogue names");
+            }
+        }
+
+        std::vector<prefix_index::PrefixIndex::Entry> prefixes;
+        prefixes.reserve(name_slots_.size());
+        for (size_t slot = 0; slot < name_slots_.size(); ++slot) {
+            prefixes.push_back({name_slots_[slot].name, static_cast<uint32_t>(slot)});
+        }
+        name_prefixes_ = prefix_index::PrefixIndex(std::move(prefixes));
+        frozen_ = true;
+    }
+
+    // Раскладывает имена по слотам функции; false, если она построена для другого набора имён
+    bool TransportCatalogue::TryUseNameIndex(const std::vector<NameSlot>& entries) {
+        if (name_index_.GetKeyCount() != entries.size()) {
+            return false;
+        }
+        name_slots_.assign(entries.size(), NameSlot{});
+        for (const NameSlot& entry : entries) {
+            NameSlot& slot = name_slots_[name_index_(entry.name)];
+            if (slot.stop || slot.bus) {
+                return false;
+            }
+            slot = entry;
+        }
+        return true;
+    }
+
+    const perfect_hash::PerfectHash& TransportCatalogue::GetNameIndex() const {
+        return name_index_;
+    }
+
+    void TransportCatalogue::BuildBusIndex() {
+        if (bus_index_ready_) {
+            return;
+        }
+        std::vector<const Bus*> sorted_buses;
+        sorted_buses.reserve(buses_.size());
+        for (const Bus& bus : buses_) {
+            sorted_buses.push_back(&bus);
+        }
+        std::sort(sorted_buses.begin(), sorted_buses.end(), [](const Bus* lhs, const Bus* rhs) {
+            return lhs->name < rhs->name;
+        });
+
+        // Подсчёт, префиксные суммы и раскладка. Маршруты обходятся в порядке имён,
+        // поэтому каждый диапазон получается уже отсортированным
+        const size_t name_count = names_.GetCount();
+        std::vector<NameId> last_bus(name_count, domain::kNoName);
+        stop_bus_offsets_.assign(name_count + 1, 0);
+        for (const Bus* bus : sorted_buses) {
+            for (std::string_view stop : bus->stops) {
+                const NameId stop_id = stops_ptr_.at(stop)->id;
+                if (last_bus[stop_id] != bus->id) {
+                    last_bus[stop_id] = bus->id;
+                    ++stop_bus_offsets_[stop_id + 1];
+                }
+            }
+        }
+        for (size_t i = 1; i <= name_count; ++i) {
+            stop_bus_offsets_[i] += stop_bus_offsets_[i - 1];
+        }
+        stop_buses_.assign(stop_bus_offsets_.back(), domain::kNoName);
+        std::vector<uint32_t> next(stop_bus_offsets_.begin(), stop_bus_offsets_.end() - 1);
+        last_bus.assign(name_count, domain::kNoName);
+        for (const Bus* bus : sorted_buses) {
+            for (std::string_view stop : bus->stops) {
+                const NameId stop_id = stops_ptr_.at(stop)->id;
+                if (last_bus[stop_id] != bus->id) {
+                    last_bus[stop_id] = bus->id;
+                    stop_buses_[next[stop_id]++] = bus->id;
+                }
+            }
+        }
+        stop_buses_.shrink_to_fit();
+        unindexed_stop_buses_.clear();
+        bus_index_ready_ = true;
+    }
+
+    bool TransportCatalogue::IsFrozen() const {
+        return frozen_;
+    }
+
+    const std::list<Stop>& TransportCatalogue::GetStops() const {
+        return stops_;
+    }
+
+    const std::list<Bus>& TransportCatalogue::GetBuses() const {
+        return buses_;
+    }
+
+    const DistanceMap& TransportCatalogue::GetDistances() const {
+        return distances_;
+    }
+
+    void TransportCatalogue::UpsertStop(std::string_view name, double lat, double lng, Invalidation& invalidation) {
+        auto it = stops_ptr_.find(name);
+        if (it == stops_ptr_.end()) {
+            AddStop(name, lat, lng);
+            invalidation.added_stops.insert(stops_.back().name);
+            return;
+        }
+        Stop* stop = it->second;
+        const geo::Coordinates coordinates{lat, lng};
+        if (stop->coordinates == coordinates) {
+            return;
+        }
+        stop->coordinates = coordinates;
+        frozen_ = false;
+        invalidation.changed_stops.insert(stop->name);
+        // Координаты влияют на географическую длину и на длину участков без заданного расстояния
+        RefreshBusesThrough(stop, stop, &invalidation);
+        if (!FindBusesThrough(stop).empty()) {
+            invalidation.map_changed = true;
+        }
+    }
+
+    void TransportCatalogue::RemoveStop(std::string_view name, Invalidation& invalidation) {
+        auto it = stops_ptr_.find(name);
+        if (it == stops_ptr_.end()) {
+            return;
+        }
+        Stop* stop = it->second;
+        for (const Bus* bus : FindBusesThrough(stop)) {
+            RemoveBus(bus->name, invalidation);
+        }
+        for (auto distance_it = distances_.begin(); distance_it != distances_.end();) {
+            if (distance_it->first.first == stop || distance_it->first.second == stop) {
+                distance_it = distances_.erase(distance_it);
+            } else {
+                ++distance_it;
+            }
+        }
+        stops_ptr_.erase(it);
+        frozen_ = false;
+        auto list_it = std::find_if(stops_.begin(), stops_.end(), [stop](const Stop& s) { return &s == stop; });
+        removed_stops_.splice(removed_stops_.end(), stops_, list_it);
+
+        invalidation.changed_stops.erase(stop->name);
+        if (invalidation.added_stops.erase(stop->name) == 0) {
+            invalidation.removed_stops.insert(stop->name);
+        }
+    }
+
+    void TransportCatalogue::UpsertBus(std::string_view name, const std::vector<std::string_view>& stops,
+                                       bool is_roundtrip, Invalidation& invalidation) {
+        std::vector<std::string_view> st;
+        if (!ResolveStopNames(stops, st)) {
+            return;
+        }
+        auto it = bus_ptr_.find(name);
+        if (it == bus_ptr_.end()) {
+            AddBus(name, stops, is_roundtrip);
+            const Bus& bus = buses_.back();
+            invalidation.added_buses.insert(bus.name);
+            for (std::string_view stop : bus.stops) {
+                invalidation.changed_stops.insert(stop);
+            }
+            invalidation.map_changed = true;
+            return;
+        }
+        Bus* bus = it->second;
+        if (bus->stops == st && bus->is_roundtrip == is_roundtrip) {
+            return;
+        }
+        MarkBusStops(*bus, &invalidation);
+        bus->stops = std::move(st);
+        bus->is_roundtrip = is_roundtrip;
+        bus_index_ready_ = false;
+        frozen_ = false;
+        NoteUnindexedBus(*bus);
+        MarkBusStops(*bus, &invalidation);
+        RefreshBusStatistics(*bus, &invalidation);
+        invalidation.map_changed = true;
+    }
+
+    void TransportCatalogue::RemoveBus(std::string_view name, Invalidation& invalidation) {
+        auto it = bus_ptr_.find(name);
+        if (it == bus_ptr_.end()) {
+            return;
+        }
+        Bus* bus = it->second;
+        MarkBusStops(*bus, &invalidation);
+        bus_index_ready_ = false;
+        frozen_ = false;
+        bus_stats_.erase(bus->name);
+        bus_ptr_.erase(it);
+        auto list_it = std::find_if(buses_.begin(), buses_.end(), [bus](const Bus& b) { return &b == bus; });
+        removed_buses_.splice(removed_buses_.end(), buses_, list_it);
+
+        invalidation.changed_buses.erase(bus->name);
+        if (invalidation.added_buses.erase(bus->name) == 0) {
+            invalidation.removed_buses.insert(bus->name);
+        }
+        invalidation.map_changed = true;
+    }
+
+    void TransportCatalogue::UpdateDistance(std::string_view stop_from, std::string_view stop_to, int distance,
+                                            Invalidation& invalidation) {
+        const Stop* from = GetStop(stop_from);
+        const Stop* to = GetStop(stop_to);
+        if (!from || !to) {
+            return;
+        }
+        auto [it, inserted] = distances_.emplace(std::make_pair(from, to), distance);
+        if (!inserted) {
+            if (it->second == distance) {
+                return;
+            }
+            it->second = distance;
+        }
+        RefreshBusesThrough(from, to, &invalidation);
+    }
+
+    // Заменяет имена остановок каноническими view из арены; false, если какой-то остановки нет
+    bool TransportCatalogue::ResolveStopNames(const std::vector<std::string_view>& stops,
+                                              std::vector<std::string_view>& result) const {
+        result.reserve(stops.size());
+        for (std::string_view stop : stops) {
+            const Stop* found = GetStop(stop);
+            if (!found) {
+                return false;
+            }
+            result.push_back(found->name);
+        }
+        return true;
+    }
+
+    // Список маршрутов у остановок маршрута меняется при его добавлении, изменении и удалении
+    void TransportCatalogue::MarkBusStops(const Bus& bus, Invalidation* invalidation) {
+        if (!invalidation) {
+            return;
+        }
+        for (std::string_view stop : bus.stops) {
+            if (!invalidation->added_stops.count(stop)) {
+                invalidation->changed_stops.insert(stop);
+            }
+        }
+    }
+
+    void TransportCatalogue::RefreshBusStatistics(const Bus& bus, Invalidation* invalidation) {
+        bus_stats_[bus.name] = CountStation(bus);
+        if (invalidation && !invalidation->added_buses.count(bus.name)) {
+            invalidation->changed_buses.insert(bus.name);
+        }
+    }
+
+    // Пересчитывает статистику маршрутов, проходящих через обе остановки
+    void TransportCatalogue::RefreshBusesThrough(const Stop* from, const Stop* to, Invalidation* invalidation) {
+        if (buses_.empty()) {
+            return;
+        }
+        for (const Bus* bus : FindBusesThrough(from)) {
+            if (from == to || std::find(bus->stops.begin(), bus->stops.end(), to->name) != bus->stops.end()) {
+                RefreshBusStatistics(*bus, invalidation);
+            }
+        }
+    }
+
+    void TransportCatalogue::NoteUnindexedBus(const Bus& bus) {
+        // Пока CSR не строился, его построит первый же поиск
+        if (stop_bus_offsets_.empty()) {
+            return;
+        }
+        for (std::string_view stop : bus.stops) {
+            unindexed_stop_buses_[stops_ptr_.at(stop)->id].push_back(bus.id);
+        }
+    }
+
+    // Действующие маршруты через остановку, без перестройки CSR между заморозками:
+    // кандидаты из устаревшего CSR и из дописанных изменений проверяются по самим маршрутам
+    std::vector<const Bus*> TransportCatalogue::FindBusesThrough(const Stop* stop) {
+        if (stop_bus_offsets_.empty()) {
+            BuildBusIndex();
+        }
+        const auto indexed = GetBusesForStop(stop->id);
+        std::vector<NameId> candidates(indexed.begin(), indexed.end());
+        if (const auto it = unindexed_stop_buses_.find(stop->id); it != unindexed_stop_buses_.end()) {
+            candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+            std::sort(candidates.begin(), candidates.end());
+            candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+        }
+        std::vector<const Bus*> result;
+        for (NameId id : candidates) {
+            const auto bus_it = bus_ptr_.find(names_.GetName(id));
+            if (bus_it == bus_ptr_.end()) {
+                continue;
+            }
+            const Bus* bus = bus_it->second;
+            if (bus_index_ready_ || std::find(bus->stops.begin(), bus->stops.end(), stop->name) != bus->stops.end()) {
+                result.push_back(bus);
+            }
+        }
+        return result;
     }
 
 } // namespace catalogue
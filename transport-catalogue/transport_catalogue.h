@@ -1,6 +1,6 @@
 #pragma once
 
-#include <deque>
+#include <list>
 #include <string>
 #include <vector>
 #include <set>
@@ -11,9 +11,15 @@
 #include <utility>
 #include "geo.cpp"
 #include "domain.h"
+#include "perfect_hash.h"
+#include "prefix_index.h"
+#include "ranges.h"
+#include "spatial_index.h"
 
 using domain::Stop;
 using domain::Bus;
+using domain::NameArena;
+using domain::NameId;
 
 namespace catalogue {
 
@@ -36,30 +42,140 @@ namespace catalogue {
         }
     };
 
+    struct NearbyStop {
+        const Stop* stop;
+        double distance;
+    };
+
+    // Имя и то, что так называется: остановка, маршрут или оба
+    struct NameMatch {
+        std::string_view name;
+        const Stop* stop;
+        const Bus* bus;
+    };
+
+    using DistanceMap = std::unordered_map<std::pair<const Stop*, const Stop*>, int, StopPairHasher>;
+
+    // Что затронуто изменением каталога. По этим именам зависимые кэши
+    // (ответы на запросы, рёбра графа маршрутов, карта) вычищаются выборочно.
+    struct Invalidation {
+        std::set<std::string_view> added_stops;
+        std::set<std::string_view> removed_stops;
+        // Изменились координаты или список проходящих автобусов
+        std::set<std::string_view> changed_stops;
+        std::set<std::string_view> added_buses;
+        std::set<std::string_view> removed_buses;
+        // Изменились состав маршрута или его статистика (расстояния, координаты)
+        std::set<std::string_view> changed_buses;
+        bool map_changed = false;
+
+        bool IsEmpty() const {
+            return added_stops.empty() && removed_stops.empty() && changed_stops.empty()
+                && added_buses.empty() && removed_buses.empty() && changed_buses.empty() && !map_changed;
+        }
+    };
+
+    // Изменяемого состояния за const-методами нет: после Freeze каталог читают
+    // из любого числа потоков без синхронизации
     class TransportCatalogue {
     public:
-        void AddStop(const std::string& name, double lat, double lng);
-        void AddBus(const std::string& name, const std::vector<std::string_view>& stops, bool is_roundtrip);
+        // Остановка с уже известным именем не добавляется второй раз: меняются её координаты
+        void AddStop(std::string_view name, double lat, double lng);
+        void AddBus(std::string_view name, const std::vector<std::string_view>& stops, bool is_roundtrip);
         void SetDistance(std::string_view stop_from, std::string_view stop_to, int distance);
         const std::unordered_map<std::string_view, Bus*>& GetAllBuses() const;
         const std::unordered_map<std::string_view, Stop*>& GetAllStops() const;
         int GetDistance(const Stop* stop_from, const Stop* stop_to) const;
         BusCounted GetBusStatistics(std::string_view bus_name) const;
-        const std::set<std::string_view>& GetBusesForStop(std::string_view stop_name) const;
+        // Номера маршрутов через остановку, отсортированные по имени маршрута.
+        // Требует замороженного каталога, иначе бросает std::logic_error
+        ranges::Range<const NameId*> GetBusesForStop(std::string_view stop_name) const;
         const Stop* GetStop(std::string_view name) const;
         const Bus* GetBus(std::string_view name) const;
+        // Номер имени действующей остановки или маршрута, иначе kNoName. В замороженном
+        // каталоге — один хэш по совершенной хэш-функции и одно сравнение строк
+        NameId FindName(std::string_view name) const;
+        // Не более limit ближайших к точке остановок не дальше max_distance метров
+        // (limit == 0 — без ограничения), по возрастанию расстояния, при равенстве — по имени.
+        // Требует замороженного каталога
+        std::vector<NearbyStop> GetStopsNearby(geo::Coordinates center, size_t limit, double max_distance) const;
+        // Первые в лексикографическом порядке limit имён остановок и маршрутов с заданным
+        // префиксом. Требует замороженного каталога
+        std::vector<NameMatch> SuggestNames(std::string_view prefix, size_t limit) const;
+        // Все имена остановок и маршрутов; на них ссылаются остальные подсистемы
+        const NameArena& GetNames() const;
+        // Остановки и маршруты в порядке добавления
+        const std::list<Stop>& GetStops() const;
+        const std::list<Bus>& GetBuses() const;
+        const DistanceMap& GetDistances() const;
+
+        // Строит плоский индекс остановка → маршруты и совершенную хэш-функцию имён.
+        // Вызывается по окончании заполнения; любое изменение снова размораживает каталог.
+        // Сохранённая функция (из бинарной базы) используется, если подходит к именам
+        void Freeze();
+        void Freeze(perfect_hash::PerfectHash name_index);
+        bool IsFrozen() const;
+        const perfect_hash::PerfectHash& GetNameIndex() const;
+
+        // Изменение уже заполненного каталога без полной перестройки. Пересчитываются
+        // только затронутые статистики маршрутов и списки автобусов остановок,
+        // всё затронутое записывается в invalidation.
+        void UpsertStop(std::string_view name, double lat, double lng, Invalidation& invalidation);
+        void RemoveStop(std::string_view name, Invalidation& invalidation);
+        void UpsertBus(std::string_view name, const std::vector<std::string_view>& stops, bool is_roundtrip,
+                       Invalidation& invalidation);
+        void RemoveBus(std::string_view name, Invalidation& invalidation);
+        void UpdateDistance(std::string_view stop_from, std::string_view stop_to, int distance,
+                            Invalidation& invalidation);
 
     private:
-        BusCounted CountStation(std::string_view bus_name) const;
-        void LinkBusToStops(std::string_view bus_name);
+        BusCounted CountStation(const Bus& bus) const;
+        bool ResolveStopNames(const std::vector<std::string_view>& stops, std::vector<std::string_view>& result) const;
+        struct NameSlot {
+            std::string_view name;
+            const Stop* stop = nullptr;
+            const Bus* bus = nullptr;
+        };
+
+        ranges::Range<const NameId*> GetBusesForStop(NameId stop_id) const;
+        void BuildBusIndex();
+        void NoteUnindexedBus(const Bus& bus);
+        std::vector<const Bus*> FindBusesThrough(const Stop* stop);
+        bool TryUseNameIndex(const std::vector<NameSlot>& entries);
+        const NameSlot* FindSlot(std::string_view name) const;
+        void MarkBusStops(const Bus& bus, Invalidation* invalidation);
+        void RefreshBusStatistics(const Bus& bus, Invalidation* invalidation);
+        void RefreshBusesThrough(const Stop* from, const Stop* to, Invalidation* invalidation);
 
-        std::deque<Stop> stops_;
-        std::deque<Bus> buses_;
+        // Объявлена первой: остальные контейнеры хранят view на её имена
+        NameArena names_;
+        std::list<Stop> stops_;
+        std::list<Bus> buses_;
+        // Удалённые объекты не освобождаются: на их имена могут ссылаться
+        // отчёты об изменениях и описания рёбер графа маршрутов
+        std::list<Stop> removed_stops_;
+        std::list<Bus> removed_buses_;
         std::unordered_map<std::string_view, Stop*> stops_ptr_;
         std::unordered_map<std::string_view, Bus*> bus_ptr_;
-        std::unordered_map<std::string_view, std::set<std::string_view>> buses_for_stop_;
-        std::unordered_map<std::pair<const Stop*, const Stop*>, int, StopPairHasher> distances_;
-        static const std::set<std::string_view>& EmptyBusSet(); 
+        // CSR: маршруты остановки с номером id лежат в
+        // stop_buses_[stop_bus_offsets_[id], stop_bus_offsets_[id + 1])
+        std::vector<uint32_t> stop_bus_offsets_;
+        std::vector<NameId> stop_buses_;
+        bool bus_index_ready_ = false;
+        // Маршруты, добавленные или изменённые после построения CSR, по остановкам.
+        // Изменения между заморозками не перестраивают CSR, а дописываются сюда
+        std::unordered_map<NameId, std::vector<NameId>> unindexed_stop_buses_;
+        // Совершенная хэш-функция по действующим именам и слоты, на которые она отображает
+        perfect_hash::PerfectHash name_index_;
+        std::vector<NameSlot> name_slots_;
+        // k-d дерево по координатам остановок; номер точки — индекс в indexed_stops_, где остановки идут по имени
+        geo::SpatialIndex stop_locations_;
+        // Префиксный индекс имён; значение — номер слота в name_slots_
+        prefix_index::PrefixIndex name_prefixes_;
+        std::vector<const Stop*> indexed_stops_;
+        bool frozen_ = false;
+        DistanceMap distances_;
+        std::unordered_map<std::string_view, BusCounted> bus_stats_;
     };
 
 } // namespace catalogue
@@ -12,22 +12,51 @@ const double kMinutesPerHour = 60.0;
 TransportRouter::TransportRouter(const catalogue::TransportCatalogue& catalogue, RoutingSettings settings)
     : catalogue_(catalogue), settings_(settings) {}
 
-void TransportRouter::AddStopVertex(const string& stop_name, int wait_time) {
+TransportRouter::TransportRouter(const catalogue::TransportCatalogue& catalogue, RoutingSettings settings,
+                                 graph::Router<double>::EdgesRange edges, size_t vertex_count,
+                                 StopVertices stop_to_vertex, vector<RouteEdgeInfo> edge_info,
+                                 const graph::Router<double>::RouteInternalData* routes_internal_data)
+    : catalogue_(catalogue)
+    , settings_(settings)
+    , router_(make_unique<graph::Router<double>>(edges, vertex_count, routes_internal_data))
+    , stop_to_vertex_(std::move(stop_to_vertex))
+    , edge_info_(std::move(edge_info))
+    , current_stop_index_(vertex_count)
+    , owns_graph_(false) {
+    for (const auto& [name, vertex] : stop_to_vertex_) {
+        IndexStopVertex(name, vertex.wait);
+    }
+}
+
+// Вершины ожидания по номеру имени остановки: концы маршрута находятся без хэш-таблицы
+void TransportRouter::IndexStopVertex(string_view stop_name, size_t wait_vertex) {
+    const NameId id = catalogue_.GetNames().Find(stop_name);
+    if (id == domain::kNoName) {
+        return;
+    }
+    if (id >= wait_vertex_by_name_.size()) {
+        wait_vertex_by_name_.resize(id + 1, kNoVertex);
+    }
+    wait_vertex_by_name_[id] = wait_vertex;
+}
+
+void TransportRouter::AddStopVertex(string_view stop_name, int wait_time) {
     StopVertex sv;
     sv.wait = current_stop_index_++;
     sv.bus = current_stop_index_++;
     stop_to_vertex_[stop_name] = sv;
+    IndexStopVertex(stop_name, sv.wait);
     graph_.AddEdge({sv.wait, sv.bus, static_cast<double>(wait_time)});
-    edge_info_.push_back({EdgeType::Wait, stop_name, static_cast<double>(wait_time), "", 0});
+    edge_info_.push_back({EdgeType::Wait, stop_name, static_cast<double>(wait_time), {}, 0});
 }
 
 void TransportRouter::FillGraphWithStops() {
     for (const auto& [name, stop_ptr] : catalogue_.GetAllStops()) {
-        AddStopVertex(std::string(name), settings_.bus_wait_time);
+        AddStopVertex(name, settings_.bus_wait_time);
     }
 }
 
-void TransportRouter::AddBusEdges(const TransportRouter::Bus& bus, bool reverse) {
+void TransportRouter::CollectBusEdges(const domain::Bus& bus, bool reverse, vector<BusEdge>& edges) const {
     int n = static_cast<int>(bus.stops.size());
     for (int i = 0; i < n; ++i) {
         int total_distance = 0;
@@ -37,10 +66,8 @@ void TransportRouter::AddBusEdges(const TransportRouter::Bus& bus, bool reverse)
             total_distance += catalogue_.GetDistance(from, to);
             double time = total_distance / kMetersPerKm * kMinutesPerHour / settings_.bus_velocity;
 
-            graph_.AddEdge({stop_to_vertex_.at(bus.stops[i]).bus,
-                            stop_to_vertex_.at(bus.stops[j]).wait,
-                            time});
-            edge_info_.push_back({EdgeType::Bus, bus.stops[i], time, bus.name, j - i});
+            edges.push_back({{stop_to_vertex_.at(bus.stops[i]).bus, stop_to_vertex_.at(bus.stops[j]).wait, time},
+                             {EdgeType::Bus, bus.stops[i], time, bus.name, j - i}});
         }
     }
 
@@ -53,39 +80,52 @@ void TransportRouter::AddBusEdges(const TransportRouter::Bus& bus, bool reverse)
                 total_distance += catalogue_.GetDistance(from, to);
                 double time = total_distance / kMetersPerKm * kMinutesPerHour / settings_.bus_velocity;
 
-                graph_.AddEdge({stop_to_vertex_.at(bus.stops[i]).bus,
-                                stop_to_vertex_.at(bus.stops[j]).wait,
-                                time});
-                edge_info_.push_back({EdgeType::Bus, bus.stops[i], time, bus.name, i - j});
+                edges.push_back({{stop_to_vertex_.at(bus.stops[i]).bus, stop_to_vertex_.at(bus.stops[j]).wait, time},
+                                 {EdgeType::Bus, bus.stops[i], time, bus.name, i - j}});
             }
         }
     }
 }
 
+void TransportRouter::AddBusEdges(const domain::Bus& bus, bool reverse) {
+    vector<BusEdge> edges;
+    CollectBusEdges(bus, reverse, edges);
+    for (const auto& [edge, info] : edges) {
+        graph_.AddEdge(edge);
+        edge_info_.push_back(info);
+    }
+}
+
 void TransportRouter::FillGraphWithBuses() {
     for (const auto& [name, bus_ptr] : catalogue_.GetAllBuses()) {
         const auto& bus = *bus_ptr;
         if (bus.stops.size() < 2) {
             continue;
         }
-        AddBusEdges({std::string(bus.name), {bus.stops.begin(), bus.stops.end()}, bus.is_roundtrip}, !bus.is_roundtrip);
+        AddBusEdges(bus, !bus.is_roundtrip);
     }
 }
 
 void TransportRouter::BuildGraph() { // Добавлены вспомогательные методы: FillGraphWithStops, FillGraphWithBuses, AddBusEdges
     current_stop_index_ = 0;
+    wait_vertex_by_name_.clear();
     graph_ = graph::DirectedWeightedGraph<double>(catalogue_.GetAllStops().size() * 2);
     FillGraphWithStops();
     FillGraphWithBuses();
     router_ = make_unique<graph::Router<double>>(graph_);
 }
 
+size_t TransportRouter::GetWaitVertex(string_view stop_name) const {
+    const NameId id = catalogue_.FindName(stop_name);
+    return id < wait_vertex_by_name_.size() ? wait_vertex_by_name_[id] : kNoVertex;
+}
+
 optional<RouteResult> TransportRouter::GetRoute(std::string_view from, std::string_view to) const {
     if (from == to) return RouteResult{0.0, {}};
-    if (!stop_to_vertex_.count(std::string(from)) || !stop_to_vertex_.count(std::string(to))) return nullopt;
+    const size_t start = GetWaitVertex(from);
+    const size_t finish = GetWaitVertex(to);
+    if (start == kNoVertex || finish == kNoVertex) return nullopt;
 
-    size_t start = stop_to_vertex_.at(std::string(from)).wait;
-    size_t finish = stop_to_vertex_.at(std::string(to)).wait;
     auto route_info_opt = router_->BuildRoute(start, finish);
     if (!route_info_opt) return nullopt;
 
@@ -96,11 +136,188 @@ optional<RouteResult> TransportRouter::GetRoute(std::string_view from, std::stri
     for (auto edge_id : route_info.edges) {
         const auto& info = edge_info_[edge_id];
         if (info.type == EdgeType::Wait) {
-            result.items.push_back({"Wait", info.stop_name, info.time, "", 0});
+            result.items.push_back({"Wait", string(info.stop_name), info.time, "", 0});
         } else {
-            result.items.push_back({"Bus", info.stop_name, info.time, info.bus, info.span_count});
+            result.items.push_back({"Bus", string(info.stop_name), info.time, string(info.bus), info.span_count});
         }
     }
 
     return result;
 }
+
+void TransportRouter::Detach() {
+    if (owns_graph_) {
+        return;
+    }
+    const auto& router = *router_;
+    graph_ = Graph(router.GetVertexCount());
+    for (const auto& edge : router.GetEdges()) {
+        graph_.AddEdge(edge);
+    }
+    vector<graph::Router<double>::RouteInternalData> routes(
+        router.GetRoutesInternalData(), router.GetRoutesInternalData() + router.GetRoutesInternalDataSize());
+    router_ = make_unique<graph::Router<double>>(graph_, std::move(routes));
+    owns_graph_ = true;
+}
+
+// Удалённое ребро превращается в петлю нулевого веса: такая петля никогда не улучшает
+// маршрут, а номера остальных рёбер (на которые ссылается матрица) не меняются
+void TransportRouter::DisableEdge(graph::EdgeId edge_id) {
+    const auto& edge = graph_.GetEdge(edge_id);
+    graph_.UpdateEdge(edge_id, edge.from, 0.0);
+}
+
+size_t TransportRouter::ApplyInvalidation(const catalogue::Invalidation& invalidation) {
+    if (!owns_graph_) {
+        throw logic_error("Router over external storage must be detached before update");
+    }
+    if (!router_) {
+        BuildGraph();
+        return graph_.GetEdgeCount();
+    }
+
+    // Рёбра затрагиваемых маршрутов и остановок — за один проход по описаниям
+    unordered_map<string_view, vector<graph::EdgeId>> bus_edges;
+    unordered_map<string_view, graph::EdgeId> wait_edges;
+    for (graph::EdgeId id = 0; id < edge_info_.size(); ++id) {
+        const auto& info = edge_info_[id];
+        const auto& edge = graph_.GetEdge(id);
+        if (edge.from == edge.to) {
+            continue;
+        }
+        if (info.type == EdgeType::Bus) {
+            if (invalidation.changed_buses.count(info.bus) || invalidation.removed_buses.count(info.bus)) {
+                bus_edges[info.bus].push_back(id);
+            }
+        } else if (invalidation.removed_stops.count(info.stop_name)) {
+            wait_edges[info.stop_name] = id;
+        }
+    }
+
+    vector<graph::EdgeId> changed;
+    for (string_view bus : invalidation.removed_buses) {
+        for (graph::EdgeId id : bus_edges[bus]) {
+            DisableEdge(id);
+            changed.push_back(id);
+        }
+    }
+    for (string_view stop : invalidation.removed_stops) {
+        if (auto it = wait_edges.find(stop); it != wait_edges.end()) {
+            DisableEdge(it->second);
+            changed.push_back(it->second);
+        }
+        stop_to_vertex_.erase(stop);
+        IndexStopVertex(stop, kNoVertex);
+    }
+    for (string_view stop : invalidation.added_stops) {
+        graph_.AddVertex();
+        graph_.AddVertex();
+        AddStopVertex(catalogue_.GetStop(stop)->name, settings_.bus_wait_time);
+        changed.push_back(graph_.GetEdgeCount() - 1);
+    }
+
+    vector<BusEdge> new_edges;
+    for (const auto* buses : {&invalidation.changed_buses, &invalidation.added_buses}) {
+        for (string_view bus_name : *buses) {
+            const auto* bus = catalogue_.GetBus(bus_name);
+            if (!bus) {
+                continue;
+            }
+            new_edges.clear();
+            if (bus->stops.size() >= 2) {
+                CollectBusEdges(*bus, !bus->is_roundtrip, new_edges);
+            }
+            auto& old_edges = bus_edges[bus_name];
+            const bool same_shape = old_edges.size() == new_edges.size()
+                && equal(old_edges.begin(), old_edges.end(), new_edges.begin(),
+                         [this](graph::EdgeId id, const BusEdge& new_edge) {
+                             const auto& edge = graph_.GetEdge(id);
+                             return edge.from == new_edge.first.from && edge.to == new_edge.first.to;
+                         });
+            if (same_shape) {
+                // Состав маршрута тот же, поменялись только расстояния — обновляем веса на месте
+                for (size_t i = 0; i < old_edges.size(); ++i) {
+                    if (graph_.GetEdge(old_edges[i]).weight != new_edges[i].first.weight) {
+                        graph_.UpdateEdge(old_edges[i], new_edges[i].first.to, new_edges[i].first.weight);
+                        edge_info_[old_edges[i]] = new_edges[i].second;
+                        changed.push_back(old_edges[i]);
+                    }
+                }
+                continue;
+            }
+            for (graph::EdgeId id : old_edges) {
+                DisableEdge(id);
+                changed.push_back(id);
+            }
+            for (const auto& [edge, info] : new_edges) {
+                changed.push_back(graph_.AddEdge(edge));
+                edge_info_.push_back(info);
+            }
+        }
+    }
+
+    if (!changed.empty()) {
+        router_->UpdateEdges(graph_, changed);
+    }
+    return changed.size();
+}
+
+const RoutingSettings& TransportRouter::GetSettings() const {
+    return settings_;
+}
+
+const graph::Router<double>& TransportRouter::GetRouter() const {
+    return *router_;
+}
+
+const TransportRouter::StopVertices& TransportRouter::GetStopVertices() const {
+    return stop_to_vertex_;
+}
+
+const vector<RouteEdgeInfo>& TransportRouter::GetEdgeInfo() const {
+    return edge_info_;
+}
+
+LazyRouter::LazyRouter(const catalogue::TransportCatalogue& catalogue, RoutingSettings settings)
+    : catalogue_(&catalogue)
+    , settings_(settings) {
+}
+
+LazyRouter::LazyRouter(const TransportRouter& router)
+    : router_(&router) {
+}
+
+LazyRouter::~LazyRouter() {
+    if (builder_.joinable()) {
+        builder_.join();
+    }
+}
+
+void LazyRouter::StartBuild() {
+    if (!catalogue_ || builder_.joinable()) {
+        return;
+    }
+    builder_ = std::thread([this] {
+        try {
+            Get();
+        } catch (...) {
+            // call_once не отметил построение выполненным: Get повторит его
+        }
+    });
+}
+
+const TransportRouter& LazyRouter::Get() const {
+    if (catalogue_) {
+        std::call_once(built_, [this] {
+            Build();
+        });
+    }
+    return *router_;
+}
+
+void LazyRouter::Build() const {
+    auto router = std::make_unique<TransportRouter>(*catalogue_, settings_);
+    router->BuildGraph();
+    owned_ = std::move(router);
+    router_ = owned_.get();
+}
@@ -7,6 +7,8 @@
 #include <unordered_map>
 #include <optional>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 struct RoutingSettings {
     int bus_wait_time;
@@ -18,11 +20,12 @@ enum class EdgeType {
     Bus
 };
 
+// Имена ссылаются на строки каталога, поэтому описание ребра не владеет памятью
 struct RouteEdgeInfo {
     EdgeType type;
-    std::string stop_name;
+    std::string_view stop_name;
     double time;
-    std::string bus;
+    std::string_view bus;
     int span_count;
 };
 
@@ -44,32 +47,87 @@ struct RouteResult {
     std::vector<RouteItem> items;
 };
 
+// GetRoute и остальные const-методы ничего не кэшируют и вызываются из разных потоков
 class TransportRouter {
 public:
-    struct Bus {
-        std::string name;
-        std::vector<std::string> stops;
-        bool is_roundtrip;
-    };
+    using Graph = graph::DirectedWeightedGraph<double>;
+    using StopVertices = std::unordered_map<std::string_view, StopVertex>;
 
     // Добавлен конструктор с ссылкой на каталог и настройки
     TransportRouter(const catalogue::TransportCatalogue& catalogue, RoutingSettings settings);
+    // Восстановление из сохранённой базы: рёбра и матрица маршрутов используются напрямую
+    // (без копирования) и должны жить дольше роутера
+    TransportRouter(const catalogue::TransportCatalogue& catalogue, RoutingSettings settings,
+                    graph::Router<double>::EdgesRange edges, size_t vertex_count,
+                    StopVertices stop_to_vertex, std::vector<RouteEdgeInfo> edge_info,
+                    const graph::Router<double>::RouteInternalData* routes_internal_data);
     // BuildGraph() стал без параметров, данные берутся из catalogue_ и settings_
     void BuildGraph();
     // Параметры from, to стали std::string_view
     std::optional<RouteResult> GetRoute(std::string_view from, std::string_view to) const;
 
+    const RoutingSettings& GetSettings() const;
+    const graph::Router<double>& GetRouter() const;
+    const StopVertices& GetStopVertices() const;
+    const std::vector<RouteEdgeInfo>& GetEdgeInfo() const;
+
+    // Копирует рёбра и матрицу из внешнего хранилища (отображённой базы) в собственную память,
+    // после чего роутер можно изменять и внешнее хранилище больше не нужно
+    void Detach();
+    // Обновляет только рёбра затронутых остановок и маршрутов и чинит только те кратчайшие
+    // пути, которые через них проходят. Возвращает число изменённых или добавленных рёбер
+    size_t ApplyInvalidation(const catalogue::Invalidation& invalidation);
+
 private:
-    void AddStopVertex(const std::string& stop_name, int wait_time);
+    using BusEdge = std::pair<graph::Edge<double>, RouteEdgeInfo>;
+
+    static constexpr size_t kNoVertex = SIZE_MAX;
+
+    void AddStopVertex(std::string_view stop_name, int wait_time);
+    void IndexStopVertex(std::string_view stop_name, size_t wait_vertex);
+    size_t GetWaitVertex(std::string_view stop_name) const;
     void FillGraphWithStops();
     void FillGraphWithBuses();
-    void AddBusEdges(const Bus& bus, bool reverse);
+    void AddBusEdges(const domain::Bus& bus, bool reverse);
+    void CollectBusEdges(const domain::Bus& bus, bool reverse, std::vector<BusEdge>& edges) const;
+    void DisableEdge(graph::EdgeId edge_id);
 
     const catalogue::TransportCatalogue& catalogue_;
     RoutingSettings settings_;
-    graph::DirectedWeightedGraph<double> graph_;
+    Graph graph_;
     std::unique_ptr<graph::Router<double>> router_;
-    std::unordered_map<std::string, StopVertex> stop_to_vertex_;
+    StopVertices stop_to_vertex_;
+    std::vector<size_t> wait_vertex_by_name_;
     std::vector<RouteEdgeInfo> edge_info_;
     size_t current_stop_index_ = 0;
+    // Граф хранится в graph_ (а не во внешней памяти), его можно изменять
+    bool owns_graph_ = true;
+};
+
+// Роутер, который строится при первом обращении: пакету без Route не нужны ни
+// граф, ни матрица кратчайших путей. StartBuild начинает построение в фоне, пока
+// отвечаются другие запросы; Get из любого потока ждёт готового роутера, и
+// строится он один раз (std::call_once). Ошибка фонового построения не теряется:
+// первый Get строит заново и пробрасывает её
+class LazyRouter {
+public:
+    LazyRouter(const catalogue::TransportCatalogue& catalogue, RoutingSettings settings);
+    // Уже готовый роутер, например из базы
+    explicit LazyRouter(const TransportRouter& router);
+    LazyRouter(const LazyRouter&) = delete;
+    LazyRouter& operator=(const LazyRouter&) = delete;
+    ~LazyRouter();
+
+    void StartBuild();
+    const TransportRouter& Get() const;
+
+private:
+    void Build() const;
+
+    const catalogue::TransportCatalogue* catalogue_ = nullptr;
+    RoutingSettings settings_{};
+    mutable std::once_flag built_;
+    mutable std::unique_ptr<TransportRouter> owned_;
+    mutable const TransportRouter* router_ = nullptr;
+    std::thread builder_;
 };